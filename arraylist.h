@@ -2,108 +2,4153 @@
 #define ARRAYLIST_H
 
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+/*
+ * Safety: For every macro method other than the `GENERATE_*` macros
+ * and the `ARRAYLIST_CREATE*` macros, you must pass a non-null ArrayList.
+ */
+
+/*
+ * Bounds checks for the unchecked accessors, enabled by defining `ARRAYLIST_DEBUG`.
+ */
+#ifdef ARRAYLIST_DEBUG
+#define ARRAYLIST_DEBUG_ASSERT(cond) assert(cond)
+#else
+#define ARRAYLIST_DEBUG_ASSERT(cond) ((void)0)
+#endif
+
+/*
+ * Returned by the search functions when no element matches.
+ */
+#define ARRAYLIST_NOT_FOUND SIZE_MAX
+
+/*
+ * Width of the vectors used by `GENERATE_ARRAYLIST_NUMERIC`. The kernels use GCC vector
+ * extensions, which compile to SSE2, AVX2 or NEON depending on the target. On x86-64 Linux
+ * they are also cloned for AVX2 and picked at load time from what the CPU supports; define
+ * `ARRAYLIST_NO_TARGET_CLONES` to build only for the compiler's target.
+ */
+#define ARRAYLIST_VECTOR_BYTES 32
+
+/*
+ * Ranges this short are insertion sorted by `GENERATE_ARRAYLIST_SORT`.
+ */
+#define ARRAYLIST_INSERTION_SORT_THRESHOLD 16
 
 /*
- * Safety: For every macro method other than `GENERATE_ARRAYLIST` 
- * and `ARRAYLIST_CREATE`, you must pass a non-null ArrayList.
+ * A sorted list merges its pending inserts once there are `ARRAYLIST_SORTED_BATCH` of them, or an
+ * eighth of its element count if that is more. Lookups scan up to `ARRAYLIST_SORTED_SCAN` pending
+ * inserts and merge them first beyond that.
  */
+#ifndef ARRAYLIST_SORTED_BATCH
+#define ARRAYLIST_SORTED_BATCH 1024
+#endif
+
+#ifndef ARRAYLIST_SORTED_SCAN
+#define ARRAYLIST_SORTED_SCAN 32
+#endif
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(ARRAYLIST_NO_TARGET_CLONES)
+#define ARRAYLIST_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define ARRAYLIST_TARGET_CLONES
+#endif
 
 /*
  * Initial capacity allocated when creating a new ArrayList.
+ * Define it as 0 before including this header to make every list allocate lazily on its first add.
  */
+#ifndef INITIAL_CAPACITY
 #define INITIAL_CAPACITY 10
+#endif
+
+/*
+ * Allocator used for an ArrayList's header and storage.
+ * `reallocate` must accept a NULL `ptr` like `realloc`. Sizes are in bytes and
+ * always match the size the block was last (re)allocated with, so arena and
+ * pool allocators may ignore `deallocate` and release everything at once.
+ * A NULL allocator means `malloc`/`realloc`/`free`.
+ */
+typedef struct arraylist_allocator_t {
+    void *(*allocate)(void *ctx, size_t size);
+    void *(*reallocate)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void  (*deallocate)(void *ctx, void *ptr, size_t size);
+    void   *ctx;
+} ArrayListAllocator;
+
+static inline void *arraylist_allocate(ArrayListAllocator *allocator, size_t size) {
+    if (allocator == NULL) {
+        return malloc(size);
+    }
+    return allocator->allocate(allocator->ctx, size);
+}
+
+static inline void *arraylist_reallocate(ArrayListAllocator *allocator, void *ptr,
+                                         size_t old_size, size_t new_size) {
+    if (allocator == NULL) {
+        return realloc(ptr, new_size);
+    }
+    return allocator->reallocate(allocator->ctx, ptr, old_size, new_size);
+}
+
+static inline void arraylist_deallocate(ArrayListAllocator *allocator, void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    if (allocator == NULL) {
+        free(ptr);
+        return;
+    }
+    allocator->deallocate(allocator->ctx, ptr, size);
+}
+
+/*
+ * An allocator for very large lists. Blocks of at least `threshold` bytes are mapped directly,
+ * rounded up to `ARRAYLIST_HUGE_PAGE_SIZE`, and advised for transparent huge pages, or taken
+ * from hugetlbfs when `hugetlb` is set and huge pages are reserved. They grow with `mremap`, so
+ * the kernel moves page tables instead of copying. Smaller blocks use `malloc`.
+ * `numa_policy` binds or interleaves the mapped pages over the nodes in `numa_nodes`.
+ * Needs Linux with `_DEFAULT_SOURCE` (the default outside strict ISO modes), and `_GNU_SOURCE`
+ * for `mremap`; otherwise every block uses `malloc`, or large blocks grow by copying.
+ */
+#ifndef ARRAYLIST_HUGE_PAGE_SIZE
+#define ARRAYLIST_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+#endif
+#ifndef ARRAYLIST_HUGE_PAGE_THRESHOLD
+#define ARRAYLIST_HUGE_PAGE_THRESHOLD ((size_t)64 * 1024 * 1024)
+#endif
+
+#if defined(__linux__) && defined(MAP_ANONYMOUS) && defined(MADV_HUGEPAGE)
+#define ARRAYLIST_HAS_HUGE_PAGES 1
+#else
+#define ARRAYLIST_HAS_HUGE_PAGES 0
+#endif
+
+typedef enum arraylist_numa_policy_t {
+    ARRAYLIST_NUMA_DEFAULT = 0,
+    ARRAYLIST_NUMA_BIND,
+    ARRAYLIST_NUMA_INTERLEAVE,
+} ArrayListNumaPolicy;
+
+typedef struct arraylist_huge_page_options_t {
+    size_t              threshold;
+    bool                hugetlb;
+    ArrayListNumaPolicy numa_policy;
+    unsigned long       numa_nodes;
+} ArrayListHugePageOptions;
+
+static inline size_t arraylist_huge_page_threshold(const ArrayListHugePageOptions *options) {
+    if (!ARRAYLIST_HAS_HUGE_PAGES) {
+        return SIZE_MAX;
+    }
+    return options == NULL || options->threshold == 0 ? ARRAYLIST_HUGE_PAGE_THRESHOLD : options->threshold;
+}
+
+static inline size_t arraylist_huge_page_round(size_t size) {
+    return (size + ARRAYLIST_HUGE_PAGE_SIZE - 1) & ~(ARRAYLIST_HUGE_PAGE_SIZE - 1);
+}
+
+/*
+ * Applies the huge page advice and NUMA policy to a mapped block. Both are best effort.
+ */
+static inline void arraylist_huge_page_advise(const ArrayListHugePageOptions *options, void *ptr, size_t length) {
+#if ARRAYLIST_HAS_HUGE_PAGES
+    madvise(ptr, length, MADV_HUGEPAGE);
+#if defined(SYS_mbind) && defined(_DEFAULT_SOURCE)
+    if (options != NULL && options->numa_policy != ARRAYLIST_NUMA_DEFAULT) {
+        /* MPOL_BIND and MPOL_INTERLEAVE from <numaif.h>, which is not always installed. */
+        int mode = options->numa_policy == ARRAYLIST_NUMA_BIND ? 2 : 3;
+        unsigned long nodes = options->numa_nodes;
+        syscall(SYS_mbind, ptr, length, mode, &nodes, sizeof(nodes) * CHAR_BIT + 1, 0);
+    }
+#endif
+#endif
+    (void)options; (void)ptr; (void)length;
+}
+
+static inline void *arraylist_huge_page_map(const ArrayListHugePageOptions *options, size_t size) {
+#if ARRAYLIST_HAS_HUGE_PAGES
+    size_t length = arraylist_huge_page_round(size);
+    void *ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if (options != NULL && options->hugetlb) {
+        ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (ptr == MAP_FAILED) {
+        ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+    arraylist_huge_page_advise(options, ptr, length);
+    return ptr;
+#else
+    (void)options; (void)size;
+    return NULL;
+#endif
+}
+
+static inline void arraylist_huge_page_unmap(void *ptr, size_t size) {
+#if ARRAYLIST_HAS_HUGE_PAGES
+    munmap(ptr, arraylist_huge_page_round(size));
+#else
+    (void)ptr; (void)size;
+#endif
+}
+
+static inline void *arraylist_huge_page_allocate(void *ctx, size_t size) {
+    const ArrayListHugePageOptions *options = ctx;
+    if (size < arraylist_huge_page_threshold(options)) {
+        return malloc(size);
+    }
+    return arraylist_huge_page_map(options, size);
+}
+
+static inline void arraylist_huge_page_deallocate(void *ctx, void *ptr, size_t size) {
+    if (size < arraylist_huge_page_threshold(ctx)) {
+        free(ptr);
+    } else {
+        arraylist_huge_page_unmap(ptr, size);
+    }
+}
+
+static inline void *arraylist_huge_page_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    const ArrayListHugePageOptions *options = ctx;
+    size_t threshold = arraylist_huge_page_threshold(options);
+    if (ptr == NULL) {
+        return arraylist_huge_page_allocate(ctx, new_size);
+    }
+    if (old_size < threshold && new_size < threshold) {
+        return realloc(ptr, new_size);
+    }
+    if (old_size >= threshold && new_size >= threshold) {
+        size_t old_length = arraylist_huge_page_round(old_size);
+        size_t new_length = arraylist_huge_page_round(new_size);
+        if (old_length == new_length) {
+            return ptr;
+        }
+#if ARRAYLIST_HAS_HUGE_PAGES && defined(MREMAP_MAYMOVE)
+        void *moved = mremap(ptr, old_length, new_length, MREMAP_MAYMOVE);
+        if (moved != MAP_FAILED) {
+            arraylist_huge_page_advise(options, moved, new_length);
+            return moved;
+        }
+#endif
+    }
+    /* Crossing the threshold, or mremap is unavailable: move the bytes. */
+    void *new_ptr = arraylist_huge_page_allocate(ctx, new_size);
+    if (new_ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        arraylist_huge_page_deallocate(ctx, ptr, old_size);
+    }
+    return new_ptr;
+}
+
+/*
+ * Returns the huge page allocator configured by `options`, which must outlive every list using it.
+ * NULL `options` means the defaults: `ARRAYLIST_HUGE_PAGE_THRESHOLD`, transparent huge pages
+ * and no NUMA policy.
+ */
+static inline ArrayListAllocator arraylist_huge_page_allocator(ArrayListHugePageOptions *options) {
+    ArrayListAllocator allocator = {
+        arraylist_huge_page_allocate,
+        arraylist_huge_page_reallocate,
+        arraylist_huge_page_deallocate,
+        options,
+    };
+    return allocator;
+}
+
+/*
+ * How an ArrayList picks its next capacity when it runs out of room.
+ * `ARRAYLIST_GROWTH_SIZE_CLASS` grows by 1.5x, then rounds the buffer up to a
+ * power of two below `ARRAYLIST_PAGE_SIZE` and to a multiple of it above, so
+ * the allocator's size classes or pages are used in full.
+ */
+typedef enum arraylist_growth_policy_t {
+    ARRAYLIST_GROWTH_1_5X = 0,
+    ARRAYLIST_GROWTH_2X,
+    ARRAYLIST_GROWTH_SIZE_CLASS,
+} ArrayListGrowthPolicy;
+
+#ifndef ARRAYLIST_PAGE_SIZE
+#define ARRAYLIST_PAGE_SIZE 4096
+#endif
+
+/*
+ * Returns the capacity to grow to from `capacity` under `policy`, never less than `min_capacity`.
+ */
+static inline size_t arraylist_next_capacity(size_t capacity, size_t min_capacity,
+                                             size_t element_size, ArrayListGrowthPolicy policy) {
+    size_t new_capacity;
+    if (policy == ARRAYLIST_GROWTH_2X) {
+        if (__builtin_mul_overflow(capacity, 2, &new_capacity)) {
+            new_capacity = SIZE_MAX;
+        }
+    } else if (__builtin_add_overflow(capacity, capacity >> 1, &new_capacity)) {
+        new_capacity = SIZE_MAX;
+    }
+    /* `capacity >> 1` is 0 when `capacity < 2`, and a bulk add may need more than the policy gives, */
+    /* so never grow by less than what was asked for. */
+    if (new_capacity < min_capacity) {
+        new_capacity = min_capacity;
+    }
+    if (policy == ARRAYLIST_GROWTH_SIZE_CLASS) {
+        size_t bytes;
+        if (__builtin_mul_overflow(new_capacity, element_size, &bytes)) {
+            return new_capacity;
+        }
+        size_t rounded;
+        if (bytes <= ARRAYLIST_PAGE_SIZE) {
+            rounded = 1;
+            while (rounded < bytes) {
+                rounded <<= 1;
+            }
+        } else if (__builtin_add_overflow(bytes, ARRAYLIST_PAGE_SIZE - 1, &rounded)) {
+            return new_capacity;
+        } else {
+            rounded &= ~((size_t)ARRAYLIST_PAGE_SIZE - 1);
+        }
+        new_capacity = rounded / element_size;
+    }
+    return new_capacity;
+}
+
+/*
+ * Who owns an ArrayList's `data`.
+ * `ARRAYLIST_STORAGE_INLINE` storage lives inside the structure holding the list
+ * (see `GENERATE_SMALL_ARRAYLIST`); it is never freed, and the first growth
+ * moves the elements to the heap.
+ * `ARRAYLIST_STORAGE_MAPPED` storage is a file mapping made by `arraylist_map_<name>`;
+ * it is unmapped when freed, and the first growth also moves the elements to the heap.
+ * `ARRAYLIST_STORAGE_RESERVED` storage is a range of address space reserved by
+ * `arraylist_reserve_virtual_<name>`; growth commits more of it in place and never moves `data`.
+ * `ARRAYLIST_STORAGE_SHARED` storage is a heap buffer behind an `ArrayListShared` header, made by
+ * `arraylist_snapshot_<name>`; the list and its snapshots hold references to it.
+ */
+typedef enum arraylist_storage_t {
+    ARRAYLIST_STORAGE_HEAP = 0,
+    ARRAYLIST_STORAGE_INLINE,
+    ARRAYLIST_STORAGE_MAPPED,
+    ARRAYLIST_STORAGE_RESERVED,
+    ARRAYLIST_STORAGE_SHARED,
+} ArrayListStorage;
+
+/*
+ * Layout of a file written by `arraylist_save_<name>` or a stream written by `arraylist_write_fd_<name>`:
+ * this 64-byte header followed by `count` raw elements, or by `encoded_bytes` of payload in another
+ * `encoding`. Files can only be read back on machines with the same byte order and the same
+ * layout of the element type.
+ */
+#define ARRAYLIST_FILE_MAGIC "ARRLIST"
+#define ARRAYLIST_FILE_VERSION 1
+#define ARRAYLIST_FILE_BYTE_ORDER 0x01020304u
+
+typedef enum arraylist_encoding_t {
+    ARRAYLIST_ENCODING_RAW = 0,
+    ARRAYLIST_ENCODING_DELTA_VARINT,
+} ArrayListEncoding;
+
+typedef struct arraylist_file_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t element_size;
+    uint64_t count;
+    uint32_t encoding;
+    uint32_t padding;
+    uint64_t encoded_bytes;
+    uint8_t  reserved[16];
+} ArrayListFileHeader;
+
+/*
+ * How `arraylist_map_<name>` maps a file. A read-only list must not be modified.
+ * Writes to a copy-on-write list stay private to the process and never reach the file.
+ */
+typedef enum arraylist_map_mode_t {
+    ARRAYLIST_MAP_READ_ONLY = 0,
+    ARRAYLIST_MAP_COPY_ON_WRITE,
+} ArrayListMapMode;
+
+static inline void arraylist_file_header_init(ArrayListFileHeader *header, size_t element_size, size_t count) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, ARRAYLIST_FILE_MAGIC, sizeof(header->magic));
+    header->version      = ARRAYLIST_FILE_VERSION;
+    header->byte_order   = ARRAYLIST_FILE_BYTE_ORDER;
+    header->element_size = element_size;
+    header->count        = count;
+}
+
+/*
+ * Checks that `header` describes `element_size`-byte elements in `encoding`, few enough to index.
+ */
+static inline bool arraylist_file_header_matches(const ArrayListFileHeader *header, size_t element_size,
+                                                 ArrayListEncoding encoding) {
+    return memcmp(header->magic, ARRAYLIST_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == ARRAYLIST_FILE_VERSION &&
+           header->byte_order == ARRAYLIST_FILE_BYTE_ORDER &&
+           header->element_size == element_size &&
+           header->encoding == (uint32_t)encoding &&
+           header->count <= SIZE_MAX / element_size;
+}
+
+/*
+ * Checks that `header` describes raw `element_size`-byte elements, and that its elements fit in
+ * `available` bytes following the header.
+ */
+static inline bool arraylist_file_header_check(const ArrayListFileHeader *header, size_t element_size, uint64_t available) {
+    return arraylist_file_header_matches(header, element_size, ARRAYLIST_ENCODING_RAW) &&
+           header->count <= available / element_size;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/*
+ * Writes all of `buf`, retrying short and interrupted writes.
+ */
+static inline bool arraylist_write_all(int fd, const void *buf, size_t size) {
+    const char *p = buf;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+#endif
+
+/*
+ * Writes `head_size` bytes from `head` then `body_size` bytes from `body` to `fd` with `writev`,
+ * retrying short and interrupted writes. Returns false with `errno` set on failure.
+ */
+static inline bool arraylist_write_parts(int fd, const void *head, size_t head_size, const void *body, size_t body_size) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct iovec iov[2] = {
+        {(void *)head, head_size},
+        {(void *)body, body_size},
+    };
+    struct iovec *next = iov;
+    int remaining = 2;
+    while (remaining > 0) {
+        if (next->iov_len == 0) {
+            next++;
+            remaining--;
+            continue;
+        }
+        ssize_t written = writev(fd, next, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        size_t done = (size_t)written;
+        while (remaining > 0 && done >= next->iov_len) {
+            done -= next->iov_len;
+            next++;
+            remaining--;
+        }
+        if (remaining > 0) {
+            next->iov_base = (char *)next->iov_base + done;
+            next->iov_len -= done;
+        }
+    }
+    return true;
+#else
+    (void)fd; (void)head; (void)head_size; (void)body; (void)body_size;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+/*
+ * Reads exactly `size` bytes from `fd` into `buf`, retrying short and interrupted reads.
+ * Returns false with `errno` set on failure; the stream ending early fails with `EIO`.
+ */
+static inline bool arraylist_read_all(int fd, void *buf, size_t size) {
+#if defined(__unix__) || defined(__APPLE__)
+    char *p = buf;
+    while (size > 0) {
+        ssize_t got = read(fd, p, size);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (got == 0) {
+            errno = EIO;
+            return false;
+        }
+        p += got;
+        size -= (size_t)got;
+    }
+    return true;
+#else
+    (void)fd; (void)buf; (void)size;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+/*
+ * Reads a header from `fd` and checks it with `arraylist_file_header_matches`; a header that
+ * doesn't match fails with `EINVAL`.
+ */
+static inline bool arraylist_read_header(int fd, ArrayListFileHeader *header, size_t element_size,
+                                         ArrayListEncoding encoding) {
+    if (!arraylist_read_all(fd, header, sizeof(*header))) {
+        return false;
+    }
+    if (!arraylist_file_header_matches(header, element_size, encoding)) {
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * LEB128 varints of zigzag-encoded deltas, for `GENERATE_ARRAYLIST_VARINT`. A varint takes
+ * at most `ARRAYLIST_VARINT_MAX` bytes. Streams are encoded and decoded through a buffer of
+ * `ARRAYLIST_STREAM_CHUNK` bytes.
+ */
+#define ARRAYLIST_VARINT_MAX 10
+#ifndef ARRAYLIST_STREAM_CHUNK
+#define ARRAYLIST_STREAM_CHUNK (64 * 1024)
+#endif
+
+static inline uint64_t arraylist_zigzag(uint64_t delta) {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+static inline uint64_t arraylist_unzigzag(uint64_t zigzag) {
+    return (zigzag >> 1) ^ (0 - (zigzag & 1));
+}
+
+static inline size_t arraylist_varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static inline size_t arraylist_varint_put(uint8_t *p, uint64_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        p[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[size++] = (uint8_t)value;
+    return size;
+}
+
+/*
+ * Decodes a varint from the `available` bytes at `p`, and returns its size, or 0 if it is
+ * truncated or too long.
+ */
+static inline size_t arraylist_varint_get(const uint8_t *p, size_t available, uint64_t *value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < available && i < ARRAYLIST_VARINT_MAX; i++) {
+        result |= (uint64_t)(p[i] & 0x7f) << (7 * i);
+        if ((p[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Writes a header and `count` elements to a temporary file next to `path`, then renames it over
+ * `path`, so readers (including mappings of the old file) never see a partial file.
+ * Returns false with `errno` set on failure.
+ */
+static inline bool arraylist_file_save(const char *path, const void *data, size_t element_size, size_t count) {
+#if defined(__unix__) || defined(__APPLE__)
+    size_t length = strlen(path);
+    char *tmp_path = arraylist_allocate(NULL, length + sizeof(".tmp"));
+    if (tmp_path == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+    memcpy(tmp_path, path, length);
+    memcpy(tmp_path + length, ".tmp", sizeof(".tmp"));
+    bool ok = false;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        ArrayListFileHeader header;
+        arraylist_file_header_init(&header, element_size, count);
+        ok = arraylist_write_all(fd, &header, sizeof(header)) &&
+             arraylist_write_all(fd, data, count * element_size);
+        ok = close(fd) == 0 && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok) {
+            int saved = errno;
+            unlink(tmp_path);
+            errno = saved;
+        }
+    }
+    arraylist_deallocate(NULL, tmp_path, length + sizeof(".tmp"));
+    return ok;
+#else
+    (void)path; (void)data; (void)element_size; (void)count;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+/*
+ * Maps a file written by `arraylist_file_save` and returns a pointer to its first element,
+ * storing the element count in `count`. Returns NULL with `errno` set on failure; a file that
+ * does not hold `element_size`-byte elements fails with `EINVAL`.
+ */
+static inline void *arraylist_file_map(const char *path, size_t element_size, ArrayListMapMode mode, size_t *count) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    ArrayListFileHeader header;
+    ssize_t got;
+    if (fstat(fd, &st) != 0 || (got = read(fd, &header, sizeof(header))) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    if ((size_t)got != sizeof(header) ||
+        !arraylist_file_header_check(&header, element_size, (uint64_t)st.st_size - sizeof(header))) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    int prot = mode == ARRAYLIST_MAP_READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+    void *base = mmap(NULL, sizeof(header) + header.count * element_size, prot, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    *count = (size_t)header.count;
+    return (char *)base + sizeof(header);
+#else
+    (void)path; (void)element_size; (void)mode; (void)count;
+    errno = ENOSYS;
+    return NULL;
+#endif
+}
+
+/*
+ * Unmaps elements returned by `arraylist_file_map`.
+ */
+static inline void arraylist_file_unmap(void *data, size_t element_size, size_t count) {
+#if defined(__unix__) || defined(__APPLE__)
+    munmap((char *)data - sizeof(ArrayListFileHeader), sizeof(ArrayListFileHeader) + count * element_size);
+#else
+    (void)data; (void)element_size; (void)count;
+#endif
+}
+
+/*
+ * Reserved address space for `ARRAYLIST_STORAGE_RESERVED`. The reservation starts one page before
+ * `data`; that page holds the reservation's size and how much of it is committed, so the list
+ * structure needs no extra fields. Needs `MAP_ANONYMOUS`, which strict ISO modes hide.
+ */
+#if (defined(__unix__) || defined(__APPLE__)) && defined(MAP_ANONYMOUS)
+#define ARRAYLIST_HAS_VIRTUAL_RESERVE 1
+#else
+#define ARRAYLIST_HAS_VIRTUAL_RESERVE 0
+#endif
+
+typedef struct arraylist_reservation_t {
+    size_t reserved;
+    size_t committed;
+} ArrayListReservation;
+
+static inline size_t arraylist_os_page_size(void) {
+#if defined(_SC_PAGESIZE)
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : ARRAYLIST_PAGE_SIZE;
+#else
+    return ARRAYLIST_PAGE_SIZE;
+#endif
+}
+
+static inline ArrayListReservation *arraylist_reservation_of(void *data) {
+    return (ArrayListReservation *)((char *)data - arraylist_os_page_size());
+}
+
+/*
+ * Reserves `bytes` of address space without committing any of it, and returns where the elements
+ * start, or NULL on failure.
+ */
+static inline void *arraylist_virtual_reserve(size_t bytes) {
+#if ARRAYLIST_HAS_VIRTUAL_RESERVE
+    size_t page = arraylist_os_page_size();
+    size_t reserved;
+    if (__builtin_add_overflow(bytes, page - 1, &reserved) ||
+        __builtin_add_overflow(reserved & ~(page - 1), page, &reserved)) {
+        return NULL;
+    }
+#if defined(MAP_NORESERVE)
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#endif
+    char *base = mmap(NULL, reserved, PROT_NONE, flags, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    if (mprotect(base, page, PROT_READ | PROT_WRITE) != 0) {
+        munmap(base, reserved);
+        return NULL;
+    }
+    ArrayListReservation *reservation = (ArrayListReservation *)base;
+    reservation->reserved  = reserved - page;
+    reservation->committed = 0;
+    return base + page;
+#else
+    (void)bytes;
+    return NULL;
+#endif
+}
+
+/*
+ * Commits the reservation up to at least `bytes`, in whole pages and never past its end,
+ * and returns the number of bytes committed, which is unchanged if committing failed.
+ */
+static inline size_t arraylist_virtual_commit(void *data, size_t bytes) {
+    ArrayListReservation *reservation = arraylist_reservation_of(data);
+#if ARRAYLIST_HAS_VIRTUAL_RESERVE
+    size_t page = arraylist_os_page_size();
+    size_t target = bytes > reservation->reserved - page + 1
+        ? reservation->reserved
+        : (bytes + page - 1) & ~(page - 1);
+    if (target > reservation->committed &&
+        mprotect((char *)data + reservation->committed, target - reservation->committed,
+                 PROT_READ | PROT_WRITE) == 0) {
+        reservation->committed = target;
+    }
+#else
+    (void)bytes;
+#endif
+    return reservation->committed;
+}
+
+static inline void arraylist_virtual_release(void *data) {
+#if ARRAYLIST_HAS_VIRTUAL_RESERVE
+    size_t page = arraylist_os_page_size();
+    munmap((char *)data - page, arraylist_reservation_of(data)->reserved + page);
+#else
+    (void)data;
+#endif
+}
+
+/*
+ * Header in front of an `ARRAYLIST_STORAGE_SHARED` buffer. `refs` counts the list and its live
+ * snapshots. The first `shared` elements are the ones snapshots can see; whoever drops the last
+ * reference destroys them. Four words keep the elements after the header 16-byte aligned.
+ */
+typedef struct arraylist_shared_t {
+    size_t              refs;
+    size_t              shared;
+    size_t              bytes;
+    ArrayListAllocator *allocator;
+} ArrayListShared;
+
+static inline ArrayListShared *arraylist_shared_of(const void *data) {
+    return (ArrayListShared *)((char *)data - sizeof(ArrayListShared));
+}
+
+/*
+ * Segmented storage, used by the variants whose elements must never move.
+ * Segment `k` holds `ARRAYLIST_SEGMENT_BASE << k` elements, so index math is O(1)
+ * and `ARRAYLIST_MAX_SEGMENTS` segments cover every `size_t` index.
+ */
+#ifndef ARRAYLIST_SEGMENT_BASE_SHIFT
+#define ARRAYLIST_SEGMENT_BASE_SHIFT 6
+#endif
+#define ARRAYLIST_SEGMENT_BASE ((size_t)1 << ARRAYLIST_SEGMENT_BASE_SHIFT)
+#define ARRAYLIST_MAX_SEGMENTS (sizeof(size_t) * CHAR_BIT - ARRAYLIST_SEGMENT_BASE_SHIFT)
+
+static inline size_t arraylist_segment_size(size_t segment) {
+    return ARRAYLIST_SEGMENT_BASE << segment;
+}
+
+/*
+ * Returns the index of the first element of `segment`, which is also the total size of the
+ * segments before it.
+ */
+static inline size_t arraylist_segment_start(size_t segment) {
+    return (((size_t)1 << segment) - 1) << ARRAYLIST_SEGMENT_BASE_SHIFT;
+}
+
+/*
+ * Returns the segment holding `index`, and stores the index within that segment in `offset`.
+ */
+static inline size_t arraylist_segment_of(size_t index, size_t *offset) {
+    unsigned long long j = (index >> ARRAYLIST_SEGMENT_BASE_SHIFT) + 1;
+    size_t segment = (sizeof(unsigned long long) * CHAR_BIT - 1) - (size_t)__builtin_clzll(j);
+    *offset = index - arraylist_segment_start(segment);
+    return segment;
+}
+
+/*
+ * Bit-packed storage for `GENERATE_PACKED_ARRAYLIST`. Values are stored in blocks of
+ * `ARRAYLIST_PACKED_BLOCK`, each value as its offset from the block's `base` in `width` bits.
+ * Values are dealt alternately into `ARRAYLIST_PACKED_LANES` lanes of `width` 64-bit words, and
+ * the lanes are interleaved word by word, so a block takes `2 * width` words and both lanes decode
+ * side by side in one vector.
+ */
+#define ARRAYLIST_PACKED_BLOCK_SHIFT 7
+#define ARRAYLIST_PACKED_BLOCK ((size_t)1 << ARRAYLIST_PACKED_BLOCK_SHIFT)
+#define ARRAYLIST_PACKED_LANES 2
+
+typedef struct arraylist_packed_block_t {
+    uint64_t base;
+    size_t   offset;
+    unsigned width;
+} ArrayListPackedBlock;
+
+typedef uint64_t arraylist_packed_lanes __attribute__((vector_size(ARRAYLIST_PACKED_LANES * sizeof(uint64_t))));
+
+/*
+ * Returns the number of bits needed to store every offset up to `range`.
+ */
+static inline unsigned arraylist_packed_width(uint64_t range) {
+    return range == 0 ? 0 : 64 - (unsigned)__builtin_clzll(range);
+}
+
+static inline uint64_t arraylist_packed_mask(unsigned width) {
+    return width == 64 ? UINT64_MAX : ((uint64_t)1 << width) - 1;
+}
+
+/*
+ * Packs `keys[i] - base` for a whole block into the `2 * width` words at `words`.
+ */
+static inline void arraylist_packed_encode(uint64_t *words, const uint64_t *keys, uint64_t base, unsigned width) {
+    if (width == 0) {
+        return;
+    }
+    memset(words, 0, ARRAYLIST_PACKED_LANES * width * sizeof(uint64_t));
+    for (size_t i = 0; i < ARRAYLIST_PACKED_BLOCK; i++) {
+        size_t   lane  = i % ARRAYLIST_PACKED_LANES;
+        size_t   bit   = i / ARRAYLIST_PACKED_LANES * width;
+        size_t   word  = bit / 64 * ARRAYLIST_PACKED_LANES + lane;
+        unsigned shift = bit % 64;
+        uint64_t value = keys[i] - base;
+        words[word] |= value << shift;
+        if (shift + width > 64) {
+            words[word + ARRAYLIST_PACKED_LANES] |= value >> (64 - shift);
+        }
+    }
+}
+
+/*
+ * Returns the offset of the block's value at `index` from its base.
+ */
+static inline uint64_t arraylist_packed_at(const uint64_t *words, unsigned width, size_t index) {
+    if (width == 0) {
+        return 0;
+    }
+    size_t   bit   = index / ARRAYLIST_PACKED_LANES * width;
+    size_t   word  = bit / 64 * ARRAYLIST_PACKED_LANES + index % ARRAYLIST_PACKED_LANES;
+    unsigned shift = bit % 64;
+    uint64_t value = words[word] >> shift;
+    if (shift + width > 64) {
+        value |= words[word + ARRAYLIST_PACKED_LANES] << (64 - shift);
+    }
+    return value & arraylist_packed_mask(width);
+}
+
+/*
+ * Unpacks a whole block into `keys`, adding `base` back.
+ */
+ARRAYLIST_TARGET_CLONES
+static inline void arraylist_packed_decode(const uint64_t *words, uint64_t base, unsigned width, uint64_t *keys) {
+    if (width == 0) {
+        for (size_t i = 0; i < ARRAYLIST_PACKED_BLOCK; i++) {
+            keys[i] = base;
+        }
+        return;
+    }
+    uint64_t mask = arraylist_packed_mask(width);
+    for (size_t row = 0; row < ARRAYLIST_PACKED_BLOCK / ARRAYLIST_PACKED_LANES; row++) {
+        size_t   bit   = row * width;
+        size_t   word  = bit / 64 * ARRAYLIST_PACKED_LANES;
+        unsigned shift = bit % 64;
+        arraylist_packed_lanes lanes;
+        memcpy(&lanes, &words[word], sizeof(lanes));
+        lanes >>= shift;
+        if (shift + width > 64) {
+            arraylist_packed_lanes next;
+            memcpy(&next, &words[word + ARRAYLIST_PACKED_LANES], sizeof(next));
+            lanes |= next << (64 - shift);
+        }
+        lanes = (lanes & mask) + base;
+        memcpy(&keys[row * ARRAYLIST_PACKED_LANES], &lanes, sizeof(lanes));
+    }
+}
+
+/*
+ * Busy-wait hint for spin loops, and a way to give up the CPU once spinning has gone on too long
+ * (the thread being waited for may have been preempted).
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAYLIST_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define ARRAYLIST_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define ARRAYLIST_CPU_RELAX() ((void)0)
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARRAYLIST_YIELD() sched_yield()
+#else
+#define ARRAYLIST_YIELD() ((void)0)
+#endif
+
+#define ARRAYLIST_SPINS_BEFORE_YIELD 64
+
+/*
+ * Usage counters, compiled in by defining `ARRAYLIST_STATS` before including this header.
+ * Each list counts its own calls and traffic; when it is destroyed or deinitialized, its counters
+ * are folded into a per-name entry of a process-wide registry that `arraylist_stats_dump` prints.
+ * Without `ARRAYLIST_STATS` the hooks expand to nothing and lists carry no extra fields.
+ */
+#ifdef ARRAYLIST_STATS
+typedef struct arraylist_stats_t {
+    size_t grows;
+    size_t realloc_bytes;
+    size_t memmove_bytes;
+    size_t peak_count;
+    size_t peak_capacity;
+    size_t adds;
+    size_t removes;
+    size_t gets;
+} ArrayListStats;
+
+typedef struct arraylist_stats_entry_t {
+    const char                     *name;
+    ArrayListStats                  totals;
+    size_t                          lists;      /* destroys and deinits folded in */
+    int                             registered;
+    struct arraylist_stats_entry_t *next;
+} ArrayListStatsEntry;
+
+/*
+ * Head of the registry. Weak, so every translation unit including this header shares one.
+ */
+__attribute__((weak)) ArrayListStatsEntry *arraylist_stats_registry = NULL;
+
+static inline void arraylist_stats_max(size_t *target, size_t value) {
+    size_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (current < value &&
+           !__atomic_compare_exchange_n(target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/*
+ * Adds one list's counters to `entry`, registering it on first use. Safe to call from many threads.
+ */
+static inline void arraylist_stats_fold(ArrayListStatsEntry *entry, const ArrayListStats *stats) {
+    if (__atomic_exchange_n(&entry->registered, 1, __ATOMIC_ACQ_REL) == 0) {
+        entry->next = __atomic_load_n(&arraylist_stats_registry, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&arraylist_stats_registry, &entry->next, entry, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    __atomic_fetch_add(&entry->lists, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->totals.grows, stats->grows, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->totals.realloc_bytes, stats->realloc_bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->totals.memmove_bytes, stats->memmove_bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->totals.adds, stats->adds, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->totals.removes, stats->removes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->totals.gets, stats->gets, __ATOMIC_RELAXED);
+    arraylist_stats_max(&entry->totals.peak_count, stats->peak_count);
+    arraylist_stats_max(&entry->totals.peak_capacity, stats->peak_capacity);
+}
+
+/*
+ * Prints one line per registered list name. Peaks are the largest seen by any single list.
+ */
+static inline void arraylist_stats_dump(FILE *out) {
+    for (ArrayListStatsEntry *entry = __atomic_load_n(&arraylist_stats_registry, __ATOMIC_ACQUIRE);
+         entry != NULL; entry = entry->next) {
+        fprintf(out,
+                "%s: lists=%zu grows=%zu realloc_bytes=%zu memmove_bytes=%zu peak_count=%zu "
+                "peak_capacity=%zu adds=%zu removes=%zu gets=%zu\n",
+                entry->name, entry->lists, entry->totals.grows, entry->totals.realloc_bytes,
+                entry->totals.memmove_bytes, entry->totals.peak_count, entry->totals.peak_capacity,
+                entry->totals.adds, entry->totals.removes, entry->totals.gets);
+    }
+}
+
+#define ARRAYLIST_STATS_MEMBER ArrayListStats stats;
+#define ARRAYLIST_STATS_COUNT(arraylist, field, n) ((arraylist)->stats.field += (n))
+#define ARRAYLIST_STATS_PEAKS(arraylist)                                \
+    do {                                                                \
+        if ((arraylist)->count > (arraylist)->stats.peak_count) {       \
+            (arraylist)->stats.peak_count = (arraylist)->count;         \
+        }                                                               \
+        if ((arraylist)->capacity > (arraylist)->stats.peak_capacity) { \
+            (arraylist)->stats.peak_capacity = (arraylist)->capacity;   \
+        }                                                               \
+    } while (0)
+#define ARRAYLIST_STATS_RESET(arraylist) memset(&(arraylist)->stats, 0, sizeof((arraylist)->stats))
+#define ARRAYLIST_STATS_FOLD(name, arraylist) arraylist_stats_fold(&arraylist_stats_entry_##name, &(arraylist)->stats)
+
+/*
+ * Generates the registry entry for `name`,
+ * `ArrayListStats arraylist_stats_<name>(ArrayList_<name> *arraylist)`, a list's own counters, and
+ * `ArrayListStats arraylist_stats_totals_<name>(void)`, the totals of every list folded in so far.
+ */
+#define GENERATE_ARRAYLIST_STATS(name)                                                 \
+    __attribute__((weak)) ArrayListStatsEntry arraylist_stats_entry_##name = {         \
+        #name, { 0, 0, 0, 0, 0, 0, 0, 0 }, 0, 0, NULL                                  \
+    };                                                                                 \
+                                                                                       \
+    static inline ArrayListStats arraylist_stats_##name(ArrayList_##name *arraylist) { \
+        return arraylist->stats;                                                       \
+    }                                                                                  \
+                                                                                       \
+    static inline ArrayListStats arraylist_stats_totals_##name(void) {                 \
+        return arraylist_stats_entry_##name.totals;                                    \
+    }
+#else
+#define ARRAYLIST_STATS_MEMBER
+#define ARRAYLIST_STATS_COUNT(arraylist, field, n) ((void)0)
+#define ARRAYLIST_STATS_PEAKS(arraylist) ((void)0)
+#define ARRAYLIST_STATS_RESET(arraylist) ((void)0)
+#define ARRAYLIST_STATS_FOLD(name, arraylist) ((void)0)
+#define GENERATE_ARRAYLIST_STATS(name)
+#endif
+
+/*
+ * Latency tracing, compiled in by defining `ARRAYLIST_TRACE` before including this header.
+ * Every grow of a plain list and every memmove shifting elements in its add and remove paths is
+ * timed, and the time lands in a histogram for that operation, list name and thread. A thread's
+ * histograms are allocated on its first traced operation and kept until the process exits, so
+ * exports still include threads that have finished. Without `ARRAYLIST_TRACE` the hooks are
+ * plain calls and nothing is timed.
+ */
+#ifdef ARRAYLIST_TRACE
+typedef enum {
+    ARRAYLIST_TRACE_GROW,
+    ARRAYLIST_TRACE_MEMMOVE,
+    ARRAYLIST_TRACE_OPS,
+} ArrayListTraceOp;
+
+/*
+ * Buckets are log-linear: values below `ARRAYLIST_TRACE_SUB_BUCKETS` have one bucket each, and
+ * every power of two above that is split into `ARRAYLIST_TRACE_SUB_BUCKETS` equal buckets, so a
+ * bucket is never more than 1/8 wider than its lower bound.
+ */
+#define ARRAYLIST_TRACE_SUB_BITS 3
+#define ARRAYLIST_TRACE_SUB_BUCKETS (1 << ARRAYLIST_TRACE_SUB_BITS)
+#define ARRAYLIST_TRACE_BUCKETS ((64 - ARRAYLIST_TRACE_SUB_BITS + 1) * ARRAYLIST_TRACE_SUB_BUCKETS)
+
+typedef struct arraylist_trace_histogram_t {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[ARRAYLIST_TRACE_BUCKETS];
+} ArrayListTraceHistogram;
+
+typedef struct arraylist_trace_thread_t {
+    ArrayListTraceHistogram          histograms[ARRAYLIST_TRACE_OPS];
+    struct arraylist_trace_thread_t *next;
+} ArrayListTraceThread;
+
+typedef struct arraylist_trace_entry_t {
+    const char                     *name;
+    ArrayListTraceThread           *threads;
+    int                             registered;
+    struct arraylist_trace_entry_t *next;
+} ArrayListTraceEntry;
+
+/*
+ * The names that have recorded a sample, newest first. Weak for the same reason as `arraylist_stats_registry`.
+ */
+__attribute__((weak)) ArrayListTraceEntry *arraylist_trace_registry = NULL;
+
+static inline const char *arraylist_trace_op_name(ArrayListTraceOp op) {
+    return op == ARRAYLIST_TRACE_GROW ? "grow" : "memmove";
+}
+
+static inline uint64_t arraylist_trace_now(void) {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline size_t arraylist_trace_bucket(uint64_t ns) {
+    if (ns < ARRAYLIST_TRACE_SUB_BUCKETS) {
+        return (size_t)ns;
+    }
+    unsigned exponent = 63 - (unsigned)__builtin_clzll(ns);
+    return (exponent - ARRAYLIST_TRACE_SUB_BITS + 1) * ARRAYLIST_TRACE_SUB_BUCKETS +
+           ((ns >> (exponent - ARRAYLIST_TRACE_SUB_BITS)) & (ARRAYLIST_TRACE_SUB_BUCKETS - 1));
+}
+
+/*
+ * Returns the smallest value that lands in `bucket`.
+ */
+static inline uint64_t arraylist_trace_bucket_floor(size_t bucket) {
+    if (bucket < ARRAYLIST_TRACE_SUB_BUCKETS) {
+        return bucket;
+    }
+    return (uint64_t)(ARRAYLIST_TRACE_SUB_BUCKETS + (bucket & (ARRAYLIST_TRACE_SUB_BUCKETS - 1)))
+           << (bucket / ARRAYLIST_TRACE_SUB_BUCKETS - 1);
+}
+
+/*
+ * Only the owning thread writes its histograms, so a load and a store are enough; they are atomic
+ * so that exports can read while it records.
+ */
+static inline void arraylist_trace_bump(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline ArrayListTraceThread *arraylist_trace_attach(ArrayListTraceEntry *entry) {
+    ArrayListTraceThread *thread = calloc(1, sizeof(ArrayListTraceThread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    if (__atomic_exchange_n(&entry->registered, 1, __ATOMIC_ACQ_REL) == 0) {
+        entry->next = __atomic_load_n(&arraylist_trace_registry, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&arraylist_trace_registry, &entry->next, entry, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    thread->next = __atomic_load_n(&entry->threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&entry->threads, &thread->next, thread, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return thread;
+}
+
+/*
+ * Adds one sample to the calling thread's histogram for `op`. If the histograms cannot be
+ * allocated the sample is dropped.
+ */
+static inline void arraylist_trace_record(ArrayListTraceEntry *entry, ArrayListTraceThread **local,
+                                          ArrayListTraceOp op, uint64_t ns) {
+    ArrayListTraceThread *thread = *local;
+    if (__builtin_expect(thread == NULL, 0)) {
+        thread = arraylist_trace_attach(entry);
+        if (thread == NULL) {
+            return;
+        }
+        *local = thread;
+    }
+    ArrayListTraceHistogram *histogram = &thread->histograms[op];
+    arraylist_trace_bump(&histogram->count, 1);
+    arraylist_trace_bump(&histogram->sum_ns, ns);
+    arraylist_trace_bump(&histogram->buckets[arraylist_trace_bucket(ns)], 1);
+    if (ns > __atomic_load_n(&histogram->max_ns, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&histogram->max_ns, ns, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void arraylist_trace_memmove(ArrayListTraceEntry *entry, ArrayListTraceThread **local,
+                                           void *dst, const void *src, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    uint64_t start = arraylist_trace_now();
+    memmove(dst, src, bytes);
+    arraylist_trace_record(entry, local, ARRAYLIST_TRACE_MEMMOVE, arraylist_trace_now() - start);
+}
+
+/*
+ * Stores in `out` the sum of every thread's histogram for `op` under `entry`.
+ */
+static inline void arraylist_trace_merge(ArrayListTraceEntry *entry, ArrayListTraceOp op,
+                                         ArrayListTraceHistogram *out) {
+    memset(out, 0, sizeof(*out));
+    for (ArrayListTraceThread *thread = __atomic_load_n(&entry->threads, __ATOMIC_ACQUIRE);
+         thread != NULL; thread = thread->next) {
+        ArrayListTraceHistogram *histogram = &thread->histograms[op];
+        out->count += __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+        out->sum_ns += __atomic_load_n(&histogram->sum_ns, __ATOMIC_RELAXED);
+        uint64_t max_ns = __atomic_load_n(&histogram->max_ns, __ATOMIC_RELAXED);
+        if (max_ns > out->max_ns) {
+            out->max_ns = max_ns;
+        }
+        for (size_t i = 0; i < ARRAYLIST_TRACE_BUCKETS; i++) {
+            out->buckets[i] += __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * Returns an upper bound on the `percentile`th (0 to 100) sample of `histogram`, within the width
+ * of its bucket, or 0 if it is empty.
+ */
+static inline uint64_t arraylist_trace_percentile(const ArrayListTraceHistogram *histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < ARRAYLIST_TRACE_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t ceiling = i + 1 < ARRAYLIST_TRACE_BUCKETS ? arraylist_trace_bucket_floor(i + 1) - 1 : UINT64_MAX;
+            return ceiling < histogram->max_ns ? ceiling : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+/*
+ * Calls `callback` with the merged histogram of every operation of every list name traced so far.
+ */
+static inline void arraylist_trace_foreach(
+    void (*callback)(void *ctx, const char *name, ArrayListTraceOp op, const ArrayListTraceHistogram *histogram),
+    void *ctx) {
+    ArrayListTraceHistogram histogram;
+    for (ArrayListTraceEntry *entry = __atomic_load_n(&arraylist_trace_registry, __ATOMIC_ACQUIRE);
+         entry != NULL; entry = entry->next) {
+        for (int op = 0; op < ARRAYLIST_TRACE_OPS; op++) {
+            arraylist_trace_merge(entry, (ArrayListTraceOp)op, &histogram);
+            callback(ctx, entry->name, (ArrayListTraceOp)op, &histogram);
+        }
+    }
+}
+
+/*
+ * Writes every traced list name as a JSON object keyed by name, then by operation, with the count,
+ * sum, maximum, common percentiles and `[floor_ns, count]` pairs for the non-empty buckets.
+ */
+static inline void arraylist_trace_dump_json(FILE *out) {
+    ArrayListTraceHistogram histogram;
+    const char *separator = "";
+    fputc('{', out);
+    for (ArrayListTraceEntry *entry = __atomic_load_n(&arraylist_trace_registry, __ATOMIC_ACQUIRE);
+         entry != NULL; entry = entry->next) {
+        fprintf(out, "%s\"%s\":{", separator, entry->name);
+        separator = ",";
+        for (int op = 0; op < ARRAYLIST_TRACE_OPS; op++) {
+            arraylist_trace_merge(entry, (ArrayListTraceOp)op, &histogram);
+            fprintf(out,
+                    "%s\"%s\":{\"count\":%llu,\"sum_ns\":%llu,\"max_ns\":%llu,\"p50_ns\":%llu,"
+                    "\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"buckets\":[",
+                    op == 0 ? "" : ",", arraylist_trace_op_name((ArrayListTraceOp)op),
+                    (unsigned long long)histogram.count, (unsigned long long)histogram.sum_ns,
+                    (unsigned long long)histogram.max_ns,
+                    (unsigned long long)arraylist_trace_percentile(&histogram, 50.0),
+                    (unsigned long long)arraylist_trace_percentile(&histogram, 90.0),
+                    (unsigned long long)arraylist_trace_percentile(&histogram, 99.0),
+                    (unsigned long long)arraylist_trace_percentile(&histogram, 99.9));
+            const char *bucket_separator = "";
+            for (size_t i = 0; i < ARRAYLIST_TRACE_BUCKETS; i++) {
+                if (histogram.buckets[i] != 0) {
+                    fprintf(out, "%s[%llu,%llu]", bucket_separator,
+                            (unsigned long long)arraylist_trace_bucket_floor(i),
+                            (unsigned long long)histogram.buckets[i]);
+                    bucket_separator = ",";
+                }
+            }
+            fputs("]}", out);
+        }
+        fputc('}', out);
+    }
+    fputs("}\n", out);
+}
+
+#define ARRAYLIST_TRACE_START(start) uint64_t start = arraylist_trace_now()
+#define ARRAYLIST_TRACE_STOP(name, op, start) \
+    arraylist_trace_record(&arraylist_trace_entry_##name, &arraylist_trace_thread_##name, op, arraylist_trace_now() - (start))
+#define ARRAYLIST_TRACE_MEMMOVE(name, dst, src, bytes) \
+    arraylist_trace_memmove(&arraylist_trace_entry_##name, &arraylist_trace_thread_##name, dst, src, bytes)
+
+/*
+ * Generates the registry entry for `name`, the calling thread's histograms for it, and
+ * `void arraylist_trace_totals_<name>(ArrayListTraceOp op, ArrayListTraceHistogram *out)`, which
+ * merges every thread's histogram for `op`.
+ */
+#define GENERATE_ARRAYLIST_TRACE(name)                                                                    \
+    __attribute__((weak)) ArrayListTraceEntry arraylist_trace_entry_##name = {#name, NULL, 0, NULL};      \
+    __attribute__((weak)) __thread ArrayListTraceThread *arraylist_trace_thread_##name = NULL;            \
+                                                                                                          \
+    static inline void arraylist_trace_totals_##name(ArrayListTraceOp op, ArrayListTraceHistogram *out) { \
+        arraylist_trace_merge(&arraylist_trace_entry_##name, op, out);                                    \
+    }
+#else
+#define ARRAYLIST_TRACE_START(start) ((void)0)
+#define ARRAYLIST_TRACE_STOP(name, op, start) ((void)0)
+#define ARRAYLIST_TRACE_MEMMOVE(name, dst, src, bytes) memmove(dst, src, bytes)
+#define GENERATE_ARRAYLIST_TRACE(name)
+#endif
+
+/*
+ * Runs the tasks of the `GENERATE_ARRAYLIST_PARALLEL` functions. `run` must call `task(arg, i)`
+ * once for every `i` in `[0, ntasks)`, from any threads, and return only after all of them have
+ * finished. `nthreads` is the parallelism the work is split for. A NULL executor means the
+ * built-in one, which runs tasks on the caller and on up to `nthreads - 1` pooled threads.
+ */
+typedef struct arraylist_executor_t {
+    void (*run)(struct arraylist_executor_t *executor, size_t ntasks,
+                void (*task)(void *arg, size_t index), void *arg);
+    void *ctx;
+    size_t nthreads;
+} ArrayListExecutor;
+
+#define ARRAYLIST_CACHE_LINE 64
+
+/*
+ * Chunks smaller than this are not worth handing to another thread.
+ */
+#ifndef ARRAYLIST_PARALLEL_MIN_CHUNK
+#define ARRAYLIST_PARALLEL_MIN_CHUNK 4096
+#endif
+
+/*
+ * Upper bound on the number of chunks a list is split into.
+ */
+#define ARRAYLIST_PARALLEL_MAX_CHUNKS 256
+
+/*
+ * Returns the number of online CPUs, or 1 if unknown.
+ */
+static inline size_t arraylist_hardware_threads(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+typedef struct arraylist_thread_job_t {
+    void (*task)(void *arg, size_t index);
+    void *arg;
+    size_t ntasks;
+    size_t next;
+} ArrayListThreadJob;
+
+static inline void *arraylist_thread_worker(void *job_ptr) {
+    ArrayListThreadJob *job = job_ptr;
+    size_t index;
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->ntasks) {
+        job->task(job->arg, index);
+    }
+    return NULL;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/*
+ * The built-in executor's threads. They are started on first use, at most as many as the
+ * largest `nthreads` asked for so far, and then wait for jobs until the process exits.
+ * One job runs at a time; `busy` is held by the thread that owns it. Weak, so every
+ * translation unit including this header shares one pool.
+ */
+typedef struct arraylist_thread_pool_t {
+    pthread_mutex_t     busy;
+    pthread_mutex_t     lock;
+    pthread_cond_t      wake;
+    pthread_cond_t      done;
+    ArrayListThreadJob *job;
+    size_t              wanted;   /* workers still to join `job` */
+    size_t              active;   /* workers that have not finished `job` */
+    size_t              nworkers;
+    pid_t               pid;      /* process the workers belong to */
+} ArrayListThreadPool;
+
+__attribute__((weak)) ArrayListThreadPool arraylist_thread_pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    NULL, 0, 0, 0, 0,
+};
+
+static inline void *arraylist_thread_pool_worker(void *pool_ptr) {
+    ArrayListThreadPool *pool = pool_ptr;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->wanted == 0) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        pool->wanted--;
+        ArrayListThreadJob *job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+        arraylist_thread_worker(job);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Runs `job` on the pool and up to `nthreads - 1` of its workers, starting workers as needed.
+ * Returns false without running anything if another job owns the pool.
+ */
+static inline bool arraylist_thread_pool_run(ArrayListThreadPool *pool, ArrayListThreadJob *job, size_t nthreads) {
+    if (pthread_mutex_trylock(&pool->busy) != 0) {
+        return false;
+    }
+    pthread_mutex_lock(&pool->lock);
+    if (pool->pid != getpid()) {
+        /* A forked child inherits the pool but none of its threads, which may still count as waiters. */
+        pool->pid = getpid();
+        pool->nworkers = 0;
+        pthread_cond_init(&pool->wake, NULL);
+        pthread_cond_init(&pool->done, NULL);
+    }
+    while (pool->nworkers + 1 < nthreads) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, arraylist_thread_pool_worker, pool) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        pool->nworkers++;
+    }
+    size_t helpers = pool->nworkers < nthreads - 1 ? pool->nworkers : nthreads - 1;
+    pool->job = job;
+    pool->wanted = helpers;
+    pool->active = helpers;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    arraylist_thread_worker(job);
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active != 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->job = NULL;
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->busy);
+    return true;
+}
+#endif
+
+/*
+ * The built-in executor. Tasks run on the calling thread and on the shared pool. If the pool is
+ * busy, with another thread's job or because a task itself runs a parallel function, the call
+ * starts its own threads and joins them. Threads that fail to start are made up for by the
+ * others, so the tasks always run; without pthreads they all run on the caller.
+ */
+static inline void arraylist_thread_run(ArrayListExecutor *executor, size_t ntasks,
+                                        void (*task)(void *arg, size_t index), void *arg) {
+    ArrayListThreadJob job = { task, arg, ntasks, 0 };
+#if defined(__unix__) || defined(__APPLE__)
+    size_t nthreads = executor->nthreads < ntasks ? executor->nthreads : ntasks;
+    if (nthreads > ARRAYLIST_PARALLEL_MAX_CHUNKS) {
+        nthreads = ARRAYLIST_PARALLEL_MAX_CHUNKS;
+    }
+    if (nthreads <= 1) {
+        arraylist_thread_worker(&job);
+        return;
+    }
+    if (arraylist_thread_pool_run(&arraylist_thread_pool, &job, nthreads)) {
+        return;
+    }
+    pthread_t threads[ARRAYLIST_PARALLEL_MAX_CHUNKS];
+    size_t started = 0;
+    while (started + 1 < nthreads &&
+           pthread_create(&threads[started], NULL, arraylist_thread_worker, &job) == 0) {
+        started++;
+    }
+    arraylist_thread_worker(&job);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    (void)executor;
+    arraylist_thread_worker(&job);
+#endif
+}
+
+/*
+ * Splits `count` elements into at most `nthreads` chunks and returns how many, storing the chunk
+ * length in `chunk`. Chunk lengths are whole cache lines, so writers of neighbouring chunks only
+ * share a line when the buffer itself is not cache-aligned.
+ */
+static inline size_t arraylist_parallel_chunks(size_t count, size_t element_size, size_t nthreads, size_t *chunk) {
+    /* Elements per cache line, or 1 when elements are whole lines. */
+    size_t unit = element_size % ARRAYLIST_CACHE_LINE == 0 ? 1 : ARRAYLIST_CACHE_LINE / (element_size & -element_size);
+    if (nthreads == 0) {
+        nthreads = 1;
+    } else if (nthreads > ARRAYLIST_PARALLEL_MAX_CHUNKS) {
+        nthreads = ARRAYLIST_PARALLEL_MAX_CHUNKS;
+    }
+    size_t length = count / nthreads + (count % nthreads != 0);
+    if (length < ARRAYLIST_PARALLEL_MIN_CHUNK) {
+        length = ARRAYLIST_PARALLEL_MIN_CHUNK;
+    }
+    length += (unit - length % unit) % unit;
+    *chunk = length;
+    return count == 0 ? 0 : count / length + (count % length != 0);
+}
+
+/*
+ * Sets up `executor` as the built-in executor with `nthreads` threads, or one per CPU if 0.
+ */
+static inline ArrayListExecutor *arraylist_default_executor(ArrayListExecutor *executor, size_t nthreads) {
+    executor->run = arraylist_thread_run;
+    executor->ctx = NULL;
+    executor->nthreads = nthreads != 0 ? nthreads : arraylist_hardware_threads();
+    return executor;
+}
+
+/*
+ * Returns `executor`, or the built-in executor with one thread per CPU, set up in `fallback`, if it is NULL.
+ */
+static inline ArrayListExecutor *arraylist_resolve_executor(ArrayListExecutor *executor, ArrayListExecutor *fallback) {
+    return executor != NULL ? executor : arraylist_default_executor(fallback, 0);
+}
+
+/*
+ * Generate `struct arraylist_<name>_t`.
+ */
+#define GENERATE_ARRAYLIST_STRUCT(name, type) \
+    typedef struct arraylist_##name##_t {     \
+        type                 *data;           \
+        size_t                count;          \
+        size_t                capacity;       \
+        ArrayListAllocator   *allocator;      \
+        ArrayListGrowthPolicy growth_policy;  \
+        ArrayListStorage      storage;        \
+        ARRAYLIST_STATS_MEMBER                \
+    } ArrayList_##name;
+
+/*
+ * Generates `enum arraylist_error_<name>_t`.
+ */
+#define GENERATE_ARRAYLIST_ERROR_ENUM(name)   \
+    typedef enum arraylist_error_##name##_t { \
+        SUCCESS_##name = 0,                   \
+        EMPTY_ARRAYLIST_ERROR_##name,         \
+        INDEX_OUT_OF_BOUNDS_ERROR_##name,     \
+        MEMORY_ERROR_##name,                  \
+        IO_ERROR_##name,                      \
+    } ArrayListError_##name;
+
+/*
+ * Generates `void arraylist_init_with_allocator_<name>(ArrayList_<name> *arraylist, ArrayListAllocator *allocator)`
+ * and `void arraylist_init_<name>(ArrayList_<name> *arraylist)`.
+ * The list starts empty with no storage.
+ */
+#define GENERATE_ARRAYLIST_INIT(name, type)                                 \
+    static inline void arraylist_init_with_allocator_##name(                \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {       \
+        arraylist->data          = NULL;                                    \
+        arraylist->count         = 0;                                       \
+        arraylist->capacity      = 0;                                       \
+        arraylist->allocator     = allocator;                               \
+        arraylist->growth_policy = ARRAYLIST_GROWTH_1_5X;                   \
+        arraylist->storage       = ARRAYLIST_STORAGE_HEAP;                  \
+        ARRAYLIST_STATS_RESET(arraylist);                                   \
+    }                                                                       \
+                                                                            \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) { \
+        arraylist_init_with_allocator_##name(arraylist, NULL);              \
+    }
+
+/*
+ * Generates `ArrayList_<name> *arraylist_create_with_capacity_and_allocator_<name>(size_t capacity, ArrayListAllocator *allocator)`,
+ * `ArrayList_<name> *arraylist_create_with_capacity_<name>(size_t capacity)`,
+ * `ArrayList_<name> *arraylist_create_with_allocator_<name>(ArrayListAllocator *allocator)`
+ * and `ArrayList_<name> *arraylist_create_<name>()`.
+ * A capacity of 0 leaves `data` NULL until the first add.
+ */
+#define GENERATE_ARRAYLIST_CREATE(name, type)                                                    \
+    static inline ArrayList_##name *arraylist_create_with_capacity_and_allocator_##name(         \
+        size_t capacity, ArrayListAllocator *allocator) {                                        \
+        size_t bytes;                                                                            \
+        if (__builtin_mul_overflow(capacity, sizeof(type), &bytes)) {                            \
+            return NULL;                                                                         \
+        }                                                                                        \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name));   \
+        if (arraylist == NULL) {                                                                 \
+            return NULL;                                                                         \
+        }                                                                                        \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                              \
+        if (capacity > 0) {                                                                      \
+            arraylist->data = arraylist_allocate(allocator, bytes);                              \
+            if (arraylist->data == NULL) {                                                       \
+                arraylist_deallocate(allocator, arraylist, sizeof(ArrayList_##name));            \
+                return NULL;                                                                     \
+            }                                                                                    \
+            arraylist->capacity = capacity;                                                      \
+        }                                                                                        \
+        return arraylist;                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_capacity_##name(size_t capacity) {     \
+        return arraylist_create_with_capacity_and_allocator_##name(capacity, NULL);              \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_allocator_##name(                      \
+        ArrayListAllocator *allocator) {                                                         \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, allocator); \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_##name() {                                  \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, NULL);      \
+    }
+
+/*
+ * Generates `void arraylist_free_data_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_FREE_DATA(name, type)                                      \
+    static inline void arraylist_free_data_##name(ArrayList_##name *arraylist) {      \
+        if (arraylist->storage == ARRAYLIST_STORAGE_HEAP) {                           \
+            arraylist_deallocate(arraylist->allocator, arraylist->data,               \
+                                 arraylist->capacity * sizeof(type));                 \
+        } else if (arraylist->storage == ARRAYLIST_STORAGE_MAPPED) {                  \
+            arraylist_file_unmap(arraylist->data, sizeof(type), arraylist->capacity); \
+        } else if (arraylist->storage == ARRAYLIST_STORAGE_RESERVED) {                \
+            arraylist_virtual_release(arraylist->data);                               \
+        } else if (arraylist->storage == ARRAYLIST_STORAGE_SHARED) {                  \
+            /* Only reached once the list holds the last reference. */                \
+            arraylist_deallocate(arraylist->allocator,                                \
+                                 arraylist_shared_of(arraylist->data),                \
+                                 sizeof(ArrayListShared) +                            \
+                                     arraylist->capacity * sizeof(type));             \
+        }                                                                             \
+    }
+
+/*
+ * Generates `void arraylist_drop_range_<name>(type *data, size_t n)`, which runs `dtor` over `n`
+ * contiguous elements, and `void arraylist_copy_range_<name>(type *dst, const type *src, size_t n)`,
+ * which runs `copy` for each of them. Relocating elements within or between buffers stays bitwise.
+ */
+#define GENERATE_ARRAYLIST_ELEMENT_HOOKS(name, type, dtor, copy)           \
+    static inline void arraylist_drop_range_##name(type *data, size_t n) { \
+        for (size_t i = 0; i < n; i++) {                                   \
+            dtor(&data[i]);                                                \
+        }                                                                  \
+    }                                                                      \
+                                                                           \
+    static inline void arraylist_copy_range_##name(                        \
+        type *restrict dst, const type *restrict src, size_t n) {          \
+        for (size_t i = 0; i < n; i++) {                                   \
+            copy(&dst[i], &src[i]);                                        \
+        }                                                                  \
+    }
+
+/*
+ * Generates `ArrayListSnapshot_<name>`, a read-only view of a list's elements, together with
+ * `ArrayListError_<name> arraylist_snapshot_<name>(ArrayList_<name> *arraylist, ArrayListSnapshot_<name> *out)`,
+ * `ArrayListSnapshot_<name> arraylist_snapshot_retain_<name>(const ArrayListSnapshot_<name> *snapshot)`,
+ * `void arraylist_snapshot_release_<name>(ArrayListSnapshot_<name> *snapshot)` and
+ * `ArrayListError_<name> arraylist_unshare_<name>(ArrayList_<name> *arraylist)`.
+ * Snapshots share the list's buffer. Appending keeps sharing it; any other change to the list
+ * first copies the buffer with the `copy` hook if a snapshot still holds it. Reserved storage must
+ * stay where it is, so a snapshot of it gets its own copy instead.
+ */
+#define GENERATE_ARRAYLIST_SHARE(name, type)                                                         \
+    typedef struct arraylist_snapshot_##name##_t {                                                   \
+        const type *data;                                                                            \
+        size_t      count;                                                                           \
+    } ArrayListSnapshot_##name;                                                                      \
+                                                                                                     \
+    static inline void arraylist_shared_unref_##name(const type *data) {                             \
+        ArrayListShared *shared = arraylist_shared_of(data);                                         \
+        if (__atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) == 0) {                           \
+            arraylist_drop_range_##name((type *)data, shared->shared);                               \
+            arraylist_deallocate(shared->allocator, shared,                                          \
+                                 sizeof(ArrayListShared) + shared->bytes);                           \
+        }                                                                                            \
+    }                                                                                                \
+                                                                                                     \
+    /* Lets go of a shared buffer, destroying the elements appended since the last snapshot. */      \
+    static inline void arraylist_shared_drop_##name(ArrayList_##name *arraylist) {                   \
+        ArrayListShared *shared = arraylist_shared_of(arraylist->data);                              \
+        arraylist_drop_range_##name(&arraylist->data[shared->shared],                                \
+                                    arraylist->count - shared->shared);                              \
+        arraylist_shared_unref_##name(arraylist->data);                                              \
+    }                                                                                                \
+                                                                                                     \
+    /* Returns whether no snapshot holds the buffer any more, so the list may change it in place. */ \
+    static inline bool arraylist_shared_claim_##name(ArrayList_##name *arraylist) {                  \
+        ArrayListShared *shared = arraylist_shared_of(arraylist->data);                              \
+        if (__atomic_load_n(&shared->refs, __ATOMIC_ACQUIRE) != 1) {                                 \
+            return false;                                                                            \
+        }                                                                                            \
+        shared->shared = 0;                                                                          \
+        return true;                                                                                 \
+    }                                                                                                \
+                                                                                                     \
+    /* Moves a shared buffer's elements into a heap buffer of `capacity` elements. */                \
+    static inline ArrayListError_##name arraylist_shared_move_##name(                                \
+        ArrayList_##name *arraylist, size_t capacity) {                                              \
+        size_t bytes;                                                                                \
+        if (__builtin_mul_overflow(capacity, sizeof(type), &bytes)) {                                \
+            return MEMORY_ERROR_##name;                                                              \
+        }                                                                                            \
+        type *new_array = arraylist_allocate(arraylist->allocator, bytes);                           \
+        if (new_array == NULL) {                                                                     \
+            return MEMORY_ERROR_##name;                                                              \
+        }                                                                                            \
+        if (arraylist_shared_claim_##name(arraylist)) {                                              \
+            memcpy(new_array, arraylist->data, arraylist->count * sizeof(type));                     \
+            arraylist_free_data_##name(arraylist);                                                   \
+        } else {                                                                                     \
+            arraylist_copy_range_##name(new_array, arraylist->data, arraylist->count);               \
+            arraylist_shared_drop_##name(arraylist);                                                 \
+        }                                                                                            \
+        arraylist->data     = new_array;                                                             \
+        arraylist->capacity = capacity;                                                              \
+        arraylist->storage  = ARRAYLIST_STORAGE_HEAP;                                                \
+        return SUCCESS_##name;                                                                       \
+    }                                                                                                \
+                                                                                                     \
+    /* Destroys the list's elements and lets go of its storage. */                                   \
+    static inline void arraylist_drop_storage_##name(ArrayList_##name *arraylist) {                  \
+        if (arraylist->storage == ARRAYLIST_STORAGE_SHARED) {                                        \
+            arraylist_shared_drop_##name(arraylist);                                                 \
+        } else {                                                                                     \
+            arraylist_drop_range_##name(arraylist->data, arraylist->count);                          \
+            arraylist_free_data_##name(arraylist);                                                   \
+        }                                                                                            \
+    }                                                                                                \
+                                                                                                     \
+    static inline ArrayListError_##name arraylist_unshare_##name(ArrayList_##name *arraylist) {      \
+        if (arraylist->storage != ARRAYLIST_STORAGE_SHARED ||                                        \
+            arraylist_shared_claim_##name(arraylist)) {                                              \
+            return SUCCESS_##name;                                                                   \
+        }                                                                                            \
+        return arraylist_shared_move_##name(arraylist, arraylist->capacity);                         \
+    }                                                                                                \
+                                                                                                     \
+    static inline ArrayListError_##name arraylist_snapshot_##name(                                   \
+        ArrayList_##name *arraylist, ArrayListSnapshot_##name *out) {                                \
+        if (arraylist->count == 0) {                                                                 \
+            out->data  = NULL;                                                                       \
+            out->count = 0;                                                                          \
+            return SUCCESS_##name;                                                                   \
+        }                                                                                            \
+        if (arraylist->storage == ARRAYLIST_STORAGE_RESERVED) {                                      \
+            size_t bytes = arraylist->count * sizeof(type);                                          \
+            size_t total;                                                                            \
+            if (__builtin_add_overflow(bytes, sizeof(ArrayListShared), &total)) {                    \
+                return MEMORY_ERROR_##name;                                                          \
+            }                                                                                        \
+            ArrayListShared *copy = arraylist_allocate(arraylist->allocator, total);                 \
+            if (copy == NULL) {                                                                      \
+                return MEMORY_ERROR_##name;                                                          \
+            }                                                                                        \
+            arraylist_copy_range_##name((type *)(copy + 1), arraylist->data, arraylist->count);      \
+            copy->refs      = 1;                                                                     \
+            copy->shared    = arraylist->count;                                                      \
+            copy->bytes     = bytes;                                                                 \
+            copy->allocator = arraylist->allocator;                                                  \
+            out->data       = (type *)(copy + 1);                                                    \
+            out->count      = arraylist->count;                                                      \
+            return SUCCESS_##name;                                                                   \
+        }                                                                                            \
+        if (arraylist->storage != ARRAYLIST_STORAGE_SHARED) {                                        \
+            bool   heap  = arraylist->storage == ARRAYLIST_STORAGE_HEAP;                             \
+            size_t bytes = (heap ? arraylist->capacity : arraylist->count) * sizeof(type);           \
+            size_t total;                                                                            \
+            if (__builtin_add_overflow(bytes, sizeof(ArrayListShared), &total)) {                    \
+                return MEMORY_ERROR_##name;                                                          \
+            }                                                                                        \
+            ArrayListShared *shared;                                                                 \
+            if (heap) {                                                                              \
+                shared = arraylist_reallocate(arraylist->allocator, arraylist->data,                 \
+                                              bytes, total);                                         \
+                if (shared == NULL) {                                                                \
+                    return MEMORY_ERROR_##name;                                                      \
+                }                                                                                    \
+                memmove(shared + 1, shared, arraylist->count * sizeof(type));                        \
+            } else {                                                                                 \
+                shared = arraylist_allocate(arraylist->allocator, total);                            \
+                if (shared == NULL) {                                                                \
+                    return MEMORY_ERROR_##name;                                                      \
+                }                                                                                    \
+                memcpy(shared + 1, arraylist->data, bytes);                                          \
+                arraylist_free_data_##name(arraylist);                                               \
+            }                                                                                        \
+            shared->refs        = 1;                                                                 \
+            shared->shared      = 0;                                                                 \
+            shared->bytes       = bytes;                                                             \
+            shared->allocator   = arraylist->allocator;                                              \
+            arraylist->data     = (type *)(shared + 1);                                              \
+            arraylist->capacity = bytes / sizeof(type);                                              \
+            arraylist->storage  = ARRAYLIST_STORAGE_SHARED;                                          \
+        }                                                                                            \
+        ArrayListShared *shared = arraylist_shared_of(arraylist->data);                              \
+        __atomic_add_fetch(&shared->refs, 1, __ATOMIC_RELAXED);                                      \
+        shared->shared = arraylist->count;                                                           \
+        out->data      = arraylist->data;                                                            \
+        out->count     = arraylist->count;                                                           \
+        return SUCCESS_##name;                                                                       \
+    }                                                                                                \
+                                                                                                     \
+    static inline ArrayListSnapshot_##name arraylist_snapshot_retain_##name(                         \
+        const ArrayListSnapshot_##name *snapshot) {                                                  \
+        if (snapshot->data != NULL) {                                                                \
+            __atomic_add_fetch(&arraylist_shared_of(snapshot->data)->refs, 1, __ATOMIC_RELAXED);     \
+        }                                                                                            \
+        return *snapshot;                                                                            \
+    }                                                                                                \
+                                                                                                     \
+    static inline void arraylist_snapshot_release_##name(ArrayListSnapshot_##name *snapshot) {       \
+        if (snapshot->data != NULL) {                                                                \
+            arraylist_shared_unref_##name(snapshot->data);                                           \
+        }                                                                                            \
+        snapshot->data  = NULL;                                                                      \
+        snapshot->count = 0;                                                                         \
+    }
+
+/*
+ * Generates `void arraylist_destroy_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_DESTROY(name, type)                                           \
+    static inline void arraylist_destroy_##name(ArrayList_##name *arraylist) {           \
+        arraylist_deinit_##name(arraylist);                                              \
+        arraylist_deallocate(arraylist->allocator, arraylist, sizeof(ArrayList_##name)); \
+    }
+
+/*
+ * Generates `void arraylist_deinit_<name>(ArrayList_<name> *arraylist)`.
+ * The list is left empty with no storage, and may be reused.
+ */
+#define GENERATE_ARRAYLIST_DEINIT(name, type)                                 \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) { \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                \
+        ARRAYLIST_STATS_RESET(arraylist);                                     \
+        arraylist_drop_storage_##name(arraylist);                             \
+        arraylist->data     = NULL;                                           \
+        arraylist->count    = 0;                                              \
+        arraylist->capacity = 0;                                              \
+        arraylist->storage  = ARRAYLIST_STORAGE_HEAP;                         \
+    }
+
+/*
+ * Generates `size_t arraylist_count_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_COUNT(name)                                         \
+    static inline size_t arraylist_count_##name(ArrayList_##name *arraylist) { \
+        return arraylist->count;                                               \
+    }
+
+/*
+ * Generates `size_t arraylist_capacity_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_CAPACITY(name)                                         \
+    static inline size_t arraylist_capacity_##name(ArrayList_##name *arraylist) { \
+        return arraylist->capacity;                                               \
+    }
+
+/*
+ * Generates `bool arraylist_is_empty_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_IS_EMPTY(name)                                       \
+    static inline bool arraylist_is_empty_##name(ArrayList_##name *arraylist) { \
+        return arraylist->count == 0;                                           \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_get_<name>(ArrayList_<name> *arraylist, size_t index, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_GET(name, type)                      \
+    static inline ArrayListError_##name arraylist_get_##name(   \
+        ArrayList_##name *arraylist, size_t index, type *out) { \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);              \
+        if (arraylist->count == 0) {                            \
+            return EMPTY_ARRAYLIST_ERROR_##name;                \
+        }                                                       \
+        if (index >= arraylist->count) {                        \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;            \
+        }                                                       \
+        if (out != NULL) {                                      \
+            *out = arraylist->data[index];                      \
+        }                                                       \
+        return SUCCESS_##name;                                  \
+    }
+
+/*
+ * Generates `type arraylist_at_unchecked_<name>(ArrayList_<name> *arraylist, size_t index)`.
+ * `index` must be less than the count; this is only checked when `ARRAYLIST_DEBUG` is defined.
+ */
+#define GENERATE_ARRAYLIST_AT_UNCHECKED(name, type)       \
+    static inline type arraylist_at_unchecked_##name(     \
+        ArrayList_##name *arraylist, size_t index) {      \
+        ARRAYLIST_DEBUG_ASSERT(index < arraylist->count); \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);        \
+        return arraylist->data[index];                    \
+    }
+
+/*
+ * Generates `type *arraylist_data_<name>(ArrayList_<name> *arraylist)` and
+ * `type *arraylist_end_<name>(ArrayList_<name> *arraylist)`.
+ * The pointers are invalidated by anything that grows or shrinks the storage.
+ */
+#define GENERATE_ARRAYLIST_DATA(name, type)                                  \
+    static inline type *arraylist_data_##name(ArrayList_##name *arraylist) { \
+        return arraylist->data;                                              \
+    }                                                                        \
+                                                                             \
+    static inline type *arraylist_end_##name(ArrayList_##name *arraylist) {  \
+        return arraylist->data + arraylist->count;                           \
+    }
+
+/*
+ * Generates `size_t arraylist_run_<name>(ArrayList_<name> *arraylist, size_t index, type **ptr)`,
+ * which stores where the contiguous run of elements starting at `index` begins in `ptr` and returns
+ * its length, or 0 past the end. Every variant has one; `GENERATE_ARRAYLIST_ITER` is built on it.
+ */
+#define GENERATE_ARRAYLIST_RUN(name, type)                                                             \
+    static inline size_t arraylist_run_##name(ArrayList_##name *arraylist, size_t index, type **ptr) { \
+        if (index >= arraylist->count) {                                                               \
+            return 0;                                                                                  \
+        }                                                                                              \
+        *ptr = &arraylist->data[index];                                                                \
+        return arraylist->count - index;                                                               \
+    }
+
+/*
+ * Generates `ArrayListIter_<name>`, a cursor over a list, with
+ * `ArrayListIter_<name> arraylist_iter_<name>(ArrayList_<name> *arraylist)` and
+ * `size_t arraylist_next_batch_<name>(ArrayListIter_<name> *iter, type **ptr, size_t max)`, which hands out
+ * the next contiguous span of at most `max` elements and returns its length, or 0 once the list is exhausted.
+ * Spans point into the list's buffer, which may be shared with snapshots; unshare it before writing through them.
+ */
+#define GENERATE_ARRAYLIST_ITER(name, type)                                                 \
+    typedef struct arraylist_iter_##name##_t {                                              \
+        ArrayList_##name *arraylist;                                                        \
+        size_t            index;                                                            \
+    } ArrayListIter_##name;                                                                 \
+                                                                                            \
+    static inline ArrayListIter_##name arraylist_iter_##name(ArrayList_##name *arraylist) { \
+        ArrayListIter_##name iter = {arraylist, 0};                                         \
+        return iter;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t arraylist_next_batch_##name(                                       \
+        ArrayListIter_##name *iter, type **ptr, size_t max) {                               \
+        ARRAYLIST_DEBUG_ASSERT(max > 0);                                                    \
+        size_t n = arraylist_run_##name(iter->arraylist, iter->index, ptr);                 \
+        if (n > max) {                                                                      \
+            n = max;                                                                        \
+        }                                                                                   \
+        iter->index += n;                                                                   \
+        return n;                                                                           \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_set_<name>(ArrayList_<name> *arraylist, size_t index, type new_element, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_SET(name, type)                                        \
+    static inline ArrayListError_##name arraylist_set_##name(                     \
+        ArrayList_##name *arraylist, size_t index, type new_element, type *out) { \
+        if (arraylist->count == 0) {                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                  \
+        }                                                                         \
+        if (index >= arraylist->count) {                                          \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                              \
+        }                                                                         \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);          \
+        if (res != SUCCESS_##name) {                                              \
+            return res;                                                           \
+        }                                                                         \
+        if (out != NULL) {                                                        \
+            *out = arraylist->data[index];                                        \
+        } else {                                                                  \
+            arraylist_drop_range_##name(&arraylist->data[index], 1);              \
+        }                                                                         \
+        arraylist->data[index] = new_element;                                     \
+        return SUCCESS_##name;                                                    \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_get_first_<name>(ArrayList_<name> *arraylist, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_GET_FIRST(name, type)                    \
+    static inline ArrayListError_##name arraylist_get_first_##name( \
+        ArrayList_##name *arraylist, type *out) {                   \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                  \
+        if (arraylist->count == 0) {                                \
+            return EMPTY_ARRAYLIST_ERROR_##name;                    \
+        }                                                           \
+        if (out != NULL) {                                          \
+            *out = arraylist->data[0];                              \
+        }                                                           \
+        return SUCCESS_##name;                                      \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_get_last_<name>(ArrayList_<name> *arraylist, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_GET_LAST(name, type)                    \
+    static inline ArrayListError_##name arraylist_get_last_##name( \
+        ArrayList_##name *arraylist, type *out) {                  \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                 \
+        if (arraylist->count == 0) {                               \
+            return EMPTY_ARRAYLIST_ERROR_##name;                   \
+        }                                                          \
+        if (out != NULL) {                                         \
+            *out = arraylist->data[arraylist->count - 1];          \
+        }                                                          \
+        return SUCCESS_##name;                                     \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_grow_<name>(ArrayList_<name> *arraylist, size_t new_capacity)`.
+ * Reserved storage grows in place and stops at the end of its reservation, so it may end up with
+ * less than `new_capacity`; callers needing a minimum check `capacity` afterwards.
+ */
+#define GENERATE_ARRAYLIST_GROW(name, type)                                          \
+    static inline ArrayListError_##name arraylist_grow_##name(                       \
+        ArrayList_##name *arraylist, size_t new_capacity) {                          \
+        assert(new_capacity > arraylist->capacity);                                  \
+        size_t bytes;                                                                \
+        if (__builtin_mul_overflow(new_capacity, sizeof(type), &bytes)) {            \
+            return MEMORY_ERROR_##name;                                              \
+        }                                                                            \
+        ARRAYLIST_TRACE_START(trace_start);                                          \
+        if (arraylist->storage == ARRAYLIST_STORAGE_SHARED) {                        \
+            ArrayListError_##name res =                                              \
+                arraylist_shared_move_##name(arraylist, new_capacity);               \
+            ARRAYLIST_TRACE_STOP(name, ARRAYLIST_TRACE_GROW, trace_start);           \
+            if (res == SUCCESS_##name) {                                             \
+                ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                          \
+                ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);              \
+                ARRAYLIST_STATS_PEAKS(arraylist);                                    \
+            }                                                                        \
+            return res;                                                              \
+        }                                                                            \
+        type *new_array;                                                             \
+        if (arraylist->storage == ARRAYLIST_STORAGE_HEAP) {                          \
+            new_array = arraylist_reallocate(arraylist->allocator,                   \
+                arraylist->data, arraylist->capacity * sizeof(type), bytes);         \
+        } else if (arraylist->storage == ARRAYLIST_STORAGE_RESERVED) {               \
+            size_t committed = arraylist_virtual_commit(arraylist->data, bytes);     \
+            ARRAYLIST_TRACE_STOP(name, ARRAYLIST_TRACE_GROW, trace_start);           \
+            if (committed / sizeof(type) <= arraylist->capacity) {                   \
+                return MEMORY_ERROR_##name;                                          \
+            }                                                                        \
+            ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                              \
+            ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                  \
+            arraylist->capacity = committed / sizeof(type);                          \
+            ARRAYLIST_STATS_PEAKS(arraylist);                                        \
+            return SUCCESS_##name;                                                   \
+        } else {                                                                     \
+            new_array = arraylist_allocate(arraylist->allocator, bytes);             \
+            if (new_array != NULL) {                                                 \
+                memcpy(new_array, arraylist->data, arraylist->count * sizeof(type)); \
+                arraylist_free_data_##name(arraylist);                               \
+                arraylist->storage = ARRAYLIST_STORAGE_HEAP;                         \
+            }                                                                        \
+        }                                                                            \
+        ARRAYLIST_TRACE_STOP(name, ARRAYLIST_TRACE_GROW, trace_start);               \
+        if (new_array == NULL) {                                                     \
+            return MEMORY_ERROR_##name;                                              \
+        }                                                                            \
+        ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                                  \
+        ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                      \
+        arraylist->data     = new_array;                                             \
+        arraylist->capacity = new_capacity;                                          \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                            \
+        return SUCCESS_##name;                                                       \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_ensure_capacity_<name>(ArrayList_<name> *arraylist, size_t min_capacity)`.
+ */
+#define GENERATE_ARRAYLIST_ENSURE_CAPACITY(name, type)                                   \
+    static inline ArrayListError_##name arraylist_ensure_capacity_##name(                \
+        ArrayList_##name *arraylist, size_t min_capacity) {                              \
+        if (min_capacity <= arraylist->capacity) {                                       \
+            return SUCCESS_##name;                                                       \
+        }                                                                                \
+        size_t new_capacity = arraylist_next_capacity(arraylist->capacity, min_capacity, \
+            sizeof(type), arraylist->growth_policy);                                     \
+        ArrayListError_##name res = arraylist_grow_##name(arraylist, new_capacity);      \
+        if (res == SUCCESS_##name && arraylist->capacity < min_capacity) {               \
+            return MEMORY_ERROR_##name;                                                  \
+        }                                                                                \
+        return res;                                                                      \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_reserve_<name>(ArrayList_<name> *arraylist, size_t capacity)`.
+ */
+#define GENERATE_ARRAYLIST_RESERVE(name, type)                                  \
+    static inline ArrayListError_##name arraylist_reserve_##name(               \
+        ArrayList_##name *arraylist, size_t capacity) {                         \
+        if (capacity <= arraylist->capacity) {                                  \
+            return SUCCESS_##name;                                              \
+        }                                                                       \
+        ArrayListError_##name res = arraylist_grow_##name(arraylist, capacity); \
+        if (res == SUCCESS_##name && arraylist->capacity < capacity) {          \
+            return MEMORY_ERROR_##name;                                         \
+        }                                                                       \
+        return res;                                                             \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_shrink_to_fit_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_SHRINK_TO_FIT(name, type)                                  \
+    static inline ArrayListError_##name arraylist_shrink_to_fit_##name(               \
+        ArrayList_##name *arraylist) {                                                \
+        if (arraylist->count == arraylist->capacity ||                                \
+            arraylist->storage != ARRAYLIST_STORAGE_HEAP) {                           \
+            return SUCCESS_##name;                                                    \
+        }                                                                             \
+        size_t old_bytes = arraylist->capacity * sizeof(type);                        \
+        if (arraylist->count == 0) {                                                  \
+            arraylist_deallocate(arraylist->allocator, arraylist->data, old_bytes);   \
+            arraylist->data     = NULL;                                               \
+            arraylist->capacity = 0;                                                  \
+            return SUCCESS_##name;                                                    \
+        }                                                                             \
+        type *new_array = arraylist_reallocate(arraylist->allocator, arraylist->data, \
+            old_bytes, arraylist->count * sizeof(type));                              \
+        if (new_array == NULL) {                                                      \
+            return MEMORY_ERROR_##name;                                               \
+        }                                                                             \
+        arraylist->data     = new_array;                                              \
+        arraylist->capacity = arraylist->count;                                       \
+        return SUCCESS_##name;                                                        \
+    }
+
+/*
+ * Generates `void arraylist_clear_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_ARRAYLIST_CLEAR(name, type)                                 \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) { \
+        if (arraylist->storage == ARRAYLIST_STORAGE_SHARED &&                \
+            !arraylist_shared_claim_##name(arraylist)) {                     \
+            arraylist_shared_drop_##name(arraylist);                         \
+            arraylist->data     = NULL;                                      \
+            arraylist->capacity = 0;                                         \
+            arraylist->storage  = ARRAYLIST_STORAGE_HEAP;                    \
+        } else {                                                             \
+            arraylist_drop_range_##name(arraylist->data, arraylist->count);  \
+        }                                                                    \
+        arraylist->count = 0;                                                \
+    }
+
+/*
+ * Generates `void arraylist_set_growth_policy_<name>(ArrayList_<name> *arraylist, ArrayListGrowthPolicy policy)`.
+ */
+#define GENERATE_ARRAYLIST_SET_GROWTH_POLICY(name)                   \
+    static inline void arraylist_set_growth_policy_##name(           \
+        ArrayList_##name *arraylist, ArrayListGrowthPolicy policy) { \
+        arraylist->growth_policy = policy;                           \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_add_<name>(ArrayList_<name> *arraylist, size_t index, type element)`.
+ */
+#define GENERATE_ARRAYLIST_ADD(name, type)                                                          \
+    static inline ArrayListError_##name arraylist_add_##name(                                       \
+        ArrayList_##name *arraylist, size_t index, type element) {                                  \
+        if (index > arraylist->count) {                                                             \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                \
+        }                                                                                           \
+        if (arraylist->count == arraylist->capacity) {                                              \
+            if (arraylist->capacity == SIZE_MAX) {                                                  \
+                return MEMORY_ERROR_##name;                                                         \
+            }                                                                                       \
+            ArrayListError_##name res = arraylist_ensure_capacity_##name(                           \
+                arraylist, arraylist->capacity + 1);                                                \
+            if (res != SUCCESS_##name) {                                                            \
+                return res;                                                                         \
+            }                                                                                       \
+        }                                                                                           \
+        if (index < arraylist->count) {                                                             \
+            ArrayListError_##name res = arraylist_unshare_##name(arraylist);                        \
+            if (res != SUCCESS_##name) {                                                            \
+                return res;                                                                         \
+            }                                                                                       \
+        }                                                                                           \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                  \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index) * sizeof(type)); \
+        ARRAYLIST_TRACE_MEMMOVE(name, &arraylist->data[index + 1], &arraylist->data[index],         \
+                                (arraylist->count - index) * sizeof(type));                         \
+        arraylist->data[index] = element;                                                           \
+        arraylist->count += 1;                                                                      \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                           \
+        return SUCCESS_##name;                                                                      \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_add_range_<name>(ArrayList_<name> *arraylist, size_t index, const type *src, size_t n)`.
+ * `src` must not point into `arraylist`.
+ */
+#define GENERATE_ARRAYLIST_ADD_RANGE(name, type)                                                    \
+    static inline ArrayListError_##name arraylist_add_range_##name(                                 \
+        ArrayList_##name *arraylist, size_t index, const type *src, size_t n) {                     \
+        if (index > arraylist->count) {                                                             \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                \
+        }                                                                                           \
+        if (n == 0) {                                                                               \
+            return SUCCESS_##name;                                                                  \
+        }                                                                                           \
+        size_t new_count;                                                                           \
+        if (__builtin_add_overflow(arraylist->count, n, &new_count)) {                              \
+            return MEMORY_ERROR_##name;                                                             \
+        }                                                                                           \
+        ArrayListError_##name res = arraylist_ensure_capacity_##name(arraylist, new_count);         \
+        if (res != SUCCESS_##name) {                                                                \
+            return res;                                                                             \
+        }                                                                                           \
+        if (index < arraylist->count) {                                                             \
+            res = arraylist_unshare_##name(arraylist);                                              \
+            if (res != SUCCESS_##name) {                                                            \
+                return res;                                                                         \
+            }                                                                                       \
+        }                                                                                           \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, n);                                                  \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index) * sizeof(type)); \
+        ARRAYLIST_TRACE_MEMMOVE(name, &arraylist->data[index + n], &arraylist->data[index],         \
+                                (arraylist->count - index) * sizeof(type));                         \
+        arraylist_copy_range_##name(&arraylist->data[index], src, n);                               \
+        arraylist->count = new_count;                                                               \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                           \
+        return SUCCESS_##name;                                                                      \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_extend_<name>(ArrayList_<name> *dst, ArrayList_<name> *src)`.
+ * `dst` and `src` may be the same list.
+ */
+#define GENERATE_ARRAYLIST_EXTEND(name, type)                                         \
+    static inline ArrayListError_##name arraylist_extend_##name(                      \
+        ArrayList_##name *dst, ArrayList_##name *src) {                               \
+        size_t n = src->count;                                                        \
+        if (n == 0) {                                                                 \
+            return SUCCESS_##name;                                                    \
+        }                                                                             \
+        size_t new_count;                                                             \
+        if (__builtin_add_overflow(dst->count, n, &new_count)) {                      \
+            return MEMORY_ERROR_##name;                                               \
+        }                                                                             \
+        ArrayListError_##name res = arraylist_ensure_capacity_##name(dst, new_count); \
+        if (res != SUCCESS_##name) {                                                  \
+            return res;                                                               \
+        }                                                                             \
+        /* Read `src->data` only after growing, in case `src == dst`. */              \
+        arraylist_copy_range_##name(&dst->data[dst->count], src->data, n);            \
+        dst->count = new_count;                                                       \
+        ARRAYLIST_STATS_COUNT(dst, adds, n);                                          \
+        ARRAYLIST_STATS_PEAKS(dst);                                                   \
+        return SUCCESS_##name;                                                        \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_add_first_<name>(ArrayList_<name> *arraylist, type element)`.
+ */
+#define GENERATE_ARRAYLIST_ADD_FIRST(name, type)                    \
+    static inline ArrayListError_##name arraylist_add_first_##name( \
+        ArrayList_##name *arraylist, type element) {                \
+        return arraylist_add_##name(arraylist, 0, element);         \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_add_last_<name>(ArrayList_<name> *arraylist, type element)`.
+ */
+#define GENERATE_ARRAYLIST_ADD_LAST(name, type)                            \
+    static inline ArrayListError_##name arraylist_add_last_##name(         \
+        ArrayList_##name *arraylist, type element) {                       \
+        return arraylist_add_##name(arraylist, arraylist->count, element); \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_remove_first_<name>(ArrayList_<name> *arraylist, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_REMOVE_FIRST(name, type)                    \
+    static inline ArrayListError_##name arraylist_remove_first_##name( \
+        ArrayList_##name *arraylist, type *out) {                      \
+        return arraylist_remove_##name(arraylist, 0, out);             \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_remove_last_<name>(ArrayList_<name> *arraylist, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_REMOVE_LAST(name, type)                            \
+    static inline ArrayListError_##name arraylist_remove_last_##name(         \
+        ArrayList_##name *arraylist, type *out) {                             \
+                    if (arraylist->count == 0) {                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                              \
+        }                                                                     \
+        return arraylist_remove_##name(arraylist, arraylist->count - 1, out); \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_remove_<name>(ArrayList_<name> *arraylist, size_t index, type *out)`.
+ */
+#define GENERATE_ARRAYLIST_REMOVE(name, type)                                                           \
+    static inline ArrayListError_##name arraylist_remove_##name(                                        \
+        ArrayList_##name *arraylist, size_t index, type *out) {                                         \
+        if (arraylist->count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                        \
+        }                                                                                               \
+        if (index >= arraylist->count) {                                                                \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                                \
+        if (res != SUCCESS_##name) {                                                                    \
+            return res;                                                                                 \
+        }                                                                                               \
+        if (out != NULL) {                                                                              \
+            *out = arraylist->data[index];                                                              \
+        } else {                                                                                        \
+            arraylist_drop_range_##name(&arraylist->data[index], 1);                                    \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                   \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index - 1) * sizeof(type)); \
+        ARRAYLIST_TRACE_MEMMOVE(name, &arraylist->data[index], &arraylist->data[index + 1],             \
+                                (arraylist->count - index - 1) * sizeof(type));                         \
+        arraylist->count -= 1;                                                                          \
+        return SUCCESS_##name;                                                                          \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_swap_remove_<name>(ArrayList_<name> *arraylist, size_t index, type *out)`.
+ * The last element takes the removed element's place, so the order is not preserved.
+ */
+#define GENERATE_ARRAYLIST_SWAP_REMOVE(name, type)                       \
+    static inline ArrayListError_##name arraylist_swap_remove_##name(    \
+        ArrayList_##name *arraylist, size_t index, type *out) {          \
+        if (arraylist->count == 0) {                                     \
+            return EMPTY_ARRAYLIST_ERROR_##name;                         \
+        }                                                                \
+        if (index >= arraylist->count) {                                 \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                     \
+        }                                                                \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist); \
+        if (res != SUCCESS_##name) {                                     \
+            return res;                                                  \
+        }                                                                \
+        if (out != NULL) {                                               \
+            *out = arraylist->data[index];                               \
+        } else {                                                         \
+            arraylist_drop_range_##name(&arraylist->data[index], 1);     \
+        }                                                                \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                    \
+        arraylist->count -= 1;                                           \
+        arraylist->data[index] = arraylist->data[arraylist->count];      \
+        return SUCCESS_##name;                                           \
+    }
+
+/*
+ * Generates `size_t arraylist_remove_if_<name>(ArrayList_<name> *arraylist, bool (*pred)(const type *element, void *ctx), void *ctx)`.
+ * Removes every element for which `pred` returns true in a single pass, keeping the order
+ * of the others, and returns how many were removed.
+ */
+#define GENERATE_ARRAYLIST_REMOVE_IF(name, type)                                                \
+    static inline size_t arraylist_remove_if_##name(                                            \
+        ArrayList_##name *arraylist, bool (*pred)(const type *element, void *ctx), void *ctx) { \
+        if (arraylist_unshare_##name(arraylist) != SUCCESS_##name) {                            \
+            return 0;                                                                           \
+        }                                                                                       \
+        size_t kept = 0;                                                                        \
+        for (size_t i = 0; i < arraylist->count; i++) {                                         \
+            if (pred(&arraylist->data[i], ctx)) {                                               \
+                arraylist_drop_range_##name(&arraylist->data[i], 1);                            \
+                continue;                                                                       \
+            }                                                                                   \
+            if (kept != i) {                                                                    \
+                arraylist->data[kept] = arraylist->data[i];                                     \
+            }                                                                                   \
+            kept += 1;                                                                          \
+        }                                                                                       \
+        size_t removed = arraylist->count - kept;                                               \
+        arraylist->count = kept;                                                                \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, removed);                                     \
+        return removed;                                                                         \
+    }
+
+/*
+ * Element hooks for types that need no cleanup and copy by assignment.
+ */
+#define ARRAYLIST_TRIVIAL_DTOR(element)  ((void)(element))
+#define ARRAYLIST_TRIVIAL_COPY(dst, src) (*(dst) = *(src))
+
+/*
+ * Generates the full implementation of an ArrayList suffixed by `name` for a given `type`.
+ */
+#define GENERATE_ARRAYLIST(name, type) \
+    GENERATE_ARRAYLIST_EX(name, type, ARRAYLIST_TRIVIAL_DTOR, ARRAYLIST_TRIVIAL_COPY)
+
+/*
+ * Generates the full implementation of an ArrayList suffixed by `name` for a given `type` whose
+ * elements own resources. `dtor(type *element)` releases an element the list discards, and
+ * `copy(type *dst, const type *src)` duplicates one into the list from a range or another list.
+ * Elements added by value, and those handed back through an `out` parameter, change owner without
+ * either hook running.
+ */
+#define GENERATE_ARRAYLIST_EX(name, type, dtor, copy)        \
+    GENERATE_ARRAYLIST_STRUCT(name, type)                    \
+    GENERATE_ARRAYLIST_STATS(name)                           \
+    GENERATE_ARRAYLIST_TRACE(name)                           \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)                      \
+    GENERATE_ARRAYLIST_ELEMENT_HOOKS(name, type, dtor, copy) \
+    GENERATE_ARRAYLIST_INIT(name, type)                      \
+    GENERATE_ARRAYLIST_CREATE(name, type)                    \
+    GENERATE_ARRAYLIST_FREE_DATA(name, type)                 \
+    GENERATE_ARRAYLIST_SHARE(name, type)                     \
+    GENERATE_ARRAYLIST_DEINIT(name, type)                    \
+    GENERATE_ARRAYLIST_DESTROY(name, type)                   \
+    GENERATE_ARRAYLIST_COUNT(name)                           \
+    GENERATE_ARRAYLIST_CAPACITY(name)                        \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)                        \
+    GENERATE_ARRAYLIST_GET(name, type)                       \
+    GENERATE_ARRAYLIST_GET_FIRST(name, type)                 \
+    GENERATE_ARRAYLIST_GET_LAST(name, type)                  \
+    GENERATE_ARRAYLIST_AT_UNCHECKED(name, type)              \
+    GENERATE_ARRAYLIST_DATA(name, type)                      \
+    GENERATE_ARRAYLIST_RUN(name, type)                       \
+    GENERATE_ARRAYLIST_ITER(name, type)                      \
+    GENERATE_ARRAYLIST_SET(name, type)                       \
+    GENERATE_ARRAYLIST_GROW(name, type)                      \
+    GENERATE_ARRAYLIST_ENSURE_CAPACITY(name, type)           \
+    GENERATE_ARRAYLIST_RESERVE(name, type)                   \
+    GENERATE_ARRAYLIST_SHRINK_TO_FIT(name, type)             \
+    GENERATE_ARRAYLIST_CLEAR(name, type)                     \
+    GENERATE_ARRAYLIST_SET_GROWTH_POLICY(name)               \
+    GENERATE_ARRAYLIST_ADD(name, type)                       \
+    GENERATE_ARRAYLIST_ADD_RANGE(name, type)                 \
+    GENERATE_ARRAYLIST_EXTEND(name, type)                    \
+    GENERATE_ARRAYLIST_ADD_FIRST(name, type)                 \
+    GENERATE_ARRAYLIST_ADD_LAST(name, type)                  \
+    GENERATE_ARRAYLIST_REMOVE(name, type)                    \
+    GENERATE_ARRAYLIST_REMOVE_FIRST(name, type)              \
+    GENERATE_ARRAYLIST_REMOVE_LAST(name, type)               \
+    GENERATE_ARRAYLIST_SWAP_REMOVE(name, type)               \
+    GENERATE_ARRAYLIST_REMOVE_IF(name, type)                 \
+    GENERATE_ARRAYLIST_PROMOTE(name, type)                   \
+    GENERATE_ARRAYLIST_OWNERSHIP(name, type)                 \
+    GENERATE_ARRAYLIST_FILE(name, type)                      \
+    GENERATE_ARRAYLIST_STREAM(name, type)                    \
+    GENERATE_ARRAYLIST_RESERVE_VIRTUAL(name, type)
+
+/*
+ * Generates `ArrayListError_<name> arraylist_promote_<name>(ArrayList_<name> *arraylist)`, which moves
+ * non-heap storage into a heap buffer of exactly `count` elements from the list's allocator.
+ */
+#define GENERATE_ARRAYLIST_PROMOTE(name, type)                                                     \
+    static inline ArrayListError_##name arraylist_promote_##name(ArrayList_##name *arraylist) {    \
+        if (arraylist->storage == ARRAYLIST_STORAGE_HEAP) {                                        \
+            return SUCCESS_##name;                                                                 \
+        }                                                                                          \
+        if (arraylist->storage == ARRAYLIST_STORAGE_SHARED &&                                      \
+            !arraylist_shared_claim_##name(arraylist)) {                                           \
+            return arraylist_shared_move_##name(arraylist, arraylist->count);                      \
+        }                                                                                          \
+        type *new_array = NULL;                                                                    \
+        if (arraylist->count > 0) {                                                                \
+            new_array = arraylist_allocate(arraylist->allocator, arraylist->count * sizeof(type)); \
+            if (new_array == NULL) {                                                               \
+                return MEMORY_ERROR_##name;                                                        \
+            }                                                                                      \
+            memcpy(new_array, arraylist->data, arraylist->count * sizeof(type));                   \
+        }                                                                                          \
+        arraylist_free_data_##name(arraylist);                                                     \
+        arraylist->data     = new_array;                                                           \
+        arraylist->capacity = arraylist->count;                                                    \
+        arraylist->storage  = ARRAYLIST_STORAGE_HEAP;                                              \
+        return SUCCESS_##name;                                                                     \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_release_<name>(ArrayList_<name> *arraylist, type **data, size_t *count, size_t *capacity)`,
+ * `ArrayListError_<name> arraylist_adopt_<name>(ArrayList_<name> *arraylist, type *data, size_t count, size_t capacity)`
+ * and `ArrayListError_<name> arraylist_swap_<name>(ArrayList_<name> *a, ArrayList_<name> *b)`.
+ * Released and adopted buffers belong to the list's allocator and are `capacity * sizeof(type)` bytes.
+ */
+#define GENERATE_ARRAYLIST_OWNERSHIP(name, type)                                                          \
+    static inline ArrayListError_##name arraylist_release_##name(                                         \
+        ArrayList_##name *arraylist, type **data, size_t *count, size_t *capacity) {                      \
+        ArrayListError_##name res = arraylist_promote_##name(arraylist);                                  \
+        if (res != SUCCESS_##name) {                                                                      \
+            return res;                                                                                   \
+        }                                                                                                 \
+        *data     = arraylist->data;                                                                      \
+        *count    = arraylist->count;                                                                     \
+        *capacity = arraylist->capacity;                                                                  \
+        arraylist->data     = NULL;                                                                       \
+        arraylist->count    = 0;                                                                          \
+        arraylist->capacity = 0;                                                                          \
+        return SUCCESS_##name;                                                                            \
+    }                                                                                                     \
+                                                                                                          \
+    static inline ArrayListError_##name arraylist_adopt_##name(                                           \
+        ArrayList_##name *arraylist, type *data, size_t count, size_t capacity) {                         \
+        if (count > capacity) {                                                                           \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                      \
+        }                                                                                                 \
+        if (data == NULL && capacity > 0) {                                                               \
+            return MEMORY_ERROR_##name;                                                                   \
+        }                                                                                                 \
+        arraylist_drop_storage_##name(arraylist);                                                         \
+        arraylist->data     = data;                                                                       \
+        arraylist->count    = count;                                                                      \
+        arraylist->capacity = capacity;                                                                   \
+        arraylist->storage  = ARRAYLIST_STORAGE_HEAP;                                                     \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                                 \
+        return SUCCESS_##name;                                                                            \
+    }                                                                                                     \
+                                                                                                          \
+    static inline ArrayListError_##name arraylist_swap_##name(ArrayList_##name *a, ArrayList_##name *b) { \
+        /* Inline storage belongs to the structure around the list, so it can't change hands. */          \
+        if ((a->storage == ARRAYLIST_STORAGE_INLINE && arraylist_promote_##name(a) != SUCCESS_##name) ||  \
+            (b->storage == ARRAYLIST_STORAGE_INLINE && arraylist_promote_##name(b) != SUCCESS_##name)) {  \
+            return MEMORY_ERROR_##name;                                                                   \
+        }                                                                                                 \
+        ArrayList_##name tmp = *a;                                                                        \
+        *a = *b;                                                                                          \
+        *b = tmp;                                                                                         \
+        return SUCCESS_##name;                                                                            \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_write_fd_<name>(ArrayList_<name> *arraylist, int fd)`,
+ * which sends a header and the elements in one `writev`, and
+ * `ArrayListError_<name> arraylist_read_fd_<name>(ArrayList_<name> *arraylist, int fd)`, which reads one
+ * such stream, reserves room for it once, and reads the elements straight into `data` after the
+ * existing ones. Failures return `IO_ERROR_<name>` with `errno` set, and leave the list's elements as they were.
+ */
+#define GENERATE_ARRAYLIST_STREAM(name, type)                                                            \
+    static inline ArrayListError_##name arraylist_write_fd_##name(ArrayList_##name *arraylist, int fd) { \
+        ArrayListFileHeader header;                                                                      \
+        arraylist_file_header_init(&header, sizeof(type), arraylist->count);                             \
+        if (!arraylist_write_parts(fd, &header, sizeof(header), arraylist->data,                         \
+                                   arraylist->count * sizeof(type))) {                                   \
+            return IO_ERROR_##name;                                                                      \
+        }                                                                                                \
+        return SUCCESS_##name;                                                                           \
+    }                                                                                                    \
+                                                                                                         \
+    static inline ArrayListError_##name arraylist_read_fd_##name(ArrayList_##name *arraylist, int fd) {  \
+        ArrayListFileHeader header;                                                                      \
+        if (!arraylist_read_header(fd, &header, sizeof(type), ARRAYLIST_ENCODING_RAW)) {                 \
+            return IO_ERROR_##name;                                                                      \
+        }                                                                                                \
+        size_t n = (size_t)header.count;                                                                 \
+        size_t new_count;                                                                                \
+        if (__builtin_add_overflow(arraylist->count, n, &new_count)) {                                   \
+            return MEMORY_ERROR_##name;                                                                  \
+        }                                                                                                \
+        ArrayListError_##name res = arraylist_reserve_##name(arraylist, new_count);                      \
+        if (res != SUCCESS_##name) {                                                                     \
+            return res;                                                                                  \
+        }                                                                                                \
+        if (n > 0 && !arraylist_read_all(fd, &arraylist->data[arraylist->count], n * sizeof(type))) {    \
+            return IO_ERROR_##name;                                                                      \
+        }                                                                                                \
+        arraylist->count = new_count;                                                                    \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, n);                                                       \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                                \
+        return SUCCESS_##name;                                                                           \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_reserve_virtual_<name>(ArrayList_<name> *arraylist, size_t max_capacity)`,
+ * which moves the list into a reservation of address space for `max_capacity` elements made up front.
+ * Pages are committed as the list grows, so `data` never moves again and pointers into it stay valid.
+ * Growth past the reservation (`max_capacity` rounded up to whole pages) fails with `MEMORY_ERROR_<name>`.
+ */
+#define GENERATE_ARRAYLIST_RESERVE_VIRTUAL(name, type)                                           \
+    static inline ArrayListError_##name arraylist_reserve_virtual_##name(                        \
+        ArrayList_##name *arraylist, size_t max_capacity) {                                      \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                         \
+        if (res != SUCCESS_##name) {                                                             \
+            return res;                                                                          \
+        }                                                                                        \
+        size_t bytes;                                                                            \
+        if (max_capacity < arraylist->count ||                                                   \
+            __builtin_mul_overflow(max_capacity, sizeof(type), &bytes)) {                        \
+            return MEMORY_ERROR_##name;                                                          \
+        }                                                                                        \
+        type *new_array = arraylist_virtual_reserve(bytes);                                      \
+        if (new_array == NULL) {                                                                 \
+            return MEMORY_ERROR_##name;                                                          \
+        }                                                                                        \
+        size_t committed = arraylist_virtual_commit(new_array, arraylist->count * sizeof(type)); \
+        if (committed < arraylist->count * sizeof(type)) {                                       \
+            arraylist_virtual_release(new_array);                                                \
+            return MEMORY_ERROR_##name;                                                          \
+        }                                                                                        \
+        if (arraylist->count > 0) {                                                              \
+            memcpy(new_array, arraylist->data, arraylist->count * sizeof(type));                 \
+        }                                                                                        \
+        arraylist_free_data_##name(arraylist);                                                   \
+        arraylist->data     = new_array;                                                         \
+        arraylist->capacity = committed / sizeof(type);                                          \
+        arraylist->storage  = ARRAYLIST_STORAGE_RESERVED;                                        \
+        return SUCCESS_##name;                                                                   \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_save_<name>(ArrayList_<name> *arraylist, const char *path)`,
+ * `ArrayList_<name> *arraylist_map_with_allocator_<name>(const char *path, ArrayListMapMode mode, ArrayListAllocator *allocator)`
+ * and `ArrayList_<name> *arraylist_map_<name>(const char *path, ArrayListMapMode mode)`.
+ * A mapped list's `data` points into the file mapping, with `capacity` equal to `count`,
+ * so the first growth copies it to the heap through `allocator`.
+ */
+#define GENERATE_ARRAYLIST_FILE(name, type)                                                                    \
+    static inline ArrayListError_##name arraylist_save_##name(ArrayList_##name *arraylist, const char *path) { \
+        if (!arraylist_file_save(path, arraylist->data, sizeof(type), arraylist->count)) {                     \
+            return IO_ERROR_##name;                                                                            \
+        }                                                                                                      \
+        return SUCCESS_##name;                                                                                 \
+    }                                                                                                          \
+                                                                                                               \
+    static inline ArrayList_##name *arraylist_map_with_allocator_##name(                                       \
+        const char *path, ArrayListMapMode mode, ArrayListAllocator *allocator) {                              \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name));                 \
+        if (arraylist == NULL) {                                                                               \
+            errno = ENOMEM;                                                                                    \
+            return NULL;                                                                                       \
+        }                                                                                                      \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                                            \
+        arraylist->data = arraylist_file_map(path, sizeof(type), mode, &arraylist->count);                     \
+        if (arraylist->data == NULL) {                                                                         \
+            int saved = errno;                                                                                 \
+            arraylist_deallocate(allocator, arraylist, sizeof(ArrayList_##name));                              \
+            errno = saved;                                                                                     \
+            return NULL;                                                                                       \
+        }                                                                                                      \
+        arraylist->capacity = arraylist->count;                                                                \
+        arraylist->storage  = ARRAYLIST_STORAGE_MAPPED;                                                        \
+        return arraylist;                                                                                      \
+    }                                                                                                          \
+                                                                                                               \
+    static inline ArrayList_##name *arraylist_map_##name(const char *path, ArrayListMapMode mode) {            \
+        return arraylist_map_with_allocator_##name(path, mode, NULL);                                          \
+    }
+
+/*
+ * Generates `void arraylist_sort_range_<name>(type *data, size_t n)`, an introsort specialized for
+ * `type` and `less`: quicksort with a median-of-three pivot, insertion sort for short ranges, and
+ * heapsort once the recursion gets deeper than 2 * log2(n). `less(a, b)` is expanded inline with
+ * two `type` lvalues and must be a strict weak ordering; it may be a function or a function-like macro.
+ */
+#define GENERATE_ARRAYLIST_SORT_RANGE(name, type, less)                                                 \
+    static inline void arraylist_insertion_sort_##name(type *data, size_t n) {                          \
+        for (size_t i = 1; i < n; i++) {                                                                \
+            type element = data[i];                                                                     \
+            size_t j = i;                                                                               \
+            while (j > 0 && less(element, data[j - 1])) {                                               \
+                data[j] = data[j - 1];                                                                  \
+                j--;                                                                                    \
+            }                                                                                           \
+            data[j] = element;                                                                          \
+        }                                                                                               \
+    }                                                                                                   \
+                                                                                                        \
+    static inline void arraylist_sift_down_##name(type *data, size_t root, size_t n) {                  \
+        type element = data[root];                                                                      \
+        size_t child;                                                                                   \
+        while ((child = 2 * root + 1) < n) {                                                            \
+            if (child + 1 < n && less(data[child], data[child + 1])) {                                  \
+                child++;                                                                                \
+            }                                                                                           \
+            if (!less(element, data[child])) {                                                          \
+                break;                                                                                  \
+            }                                                                                           \
+            data[root] = data[child];                                                                   \
+            root = child;                                                                               \
+        }                                                                                               \
+        data[root] = element;                                                                           \
+    }                                                                                                   \
+                                                                                                        \
+    static inline void arraylist_heap_sort_##name(type *data, size_t n) {                               \
+        for (size_t i = n / 2; i > 0; i--) {                                                            \
+            arraylist_sift_down_##name(data, i - 1, n);                                                 \
+        }                                                                                               \
+        for (size_t end = n; end > 1; end--) {                                                          \
+            type top = data[0];                                                                         \
+            data[0] = data[end - 1];                                                                    \
+            data[end - 1] = top;                                                                        \
+            arraylist_sift_down_##name(data, 0, end - 1);                                               \
+        }                                                                                               \
+    }                                                                                                   \
+                                                                                                        \
+    static inline void arraylist_introsort_##name(type *data, size_t n, size_t depth) {                 \
+        while (n > ARRAYLIST_INSERTION_SORT_THRESHOLD) {                                                \
+            if (depth == 0) {                                                                           \
+                arraylist_heap_sort_##name(data, n);                                                    \
+                return;                                                                                 \
+            }                                                                                           \
+            depth--;                                                                                    \
+            size_t mid = n / 2;                                                                         \
+            type tmp;                                                                                   \
+            /* Order data[0], data[mid], data[n - 1], leaving the median in data[mid]. */               \
+            if (less(data[mid], data[0])) {                                                             \
+                tmp = data[mid]; data[mid] = data[0]; data[0] = tmp;                                    \
+            }                                                                                           \
+            if (less(data[n - 1], data[mid])) {                                                         \
+                tmp = data[n - 1]; data[n - 1] = data[mid]; data[mid] = tmp;                            \
+                if (less(data[mid], data[0])) {                                                         \
+                    tmp = data[mid]; data[mid] = data[0]; data[0] = tmp;                                \
+                }                                                                                       \
+            }                                                                                           \
+            type pivot = data[mid];                                                                     \
+            size_t i = 0;                                                                               \
+            size_t j = n - 1;                                                                           \
+            for (;;) {                                                                                  \
+                while (less(data[i], pivot)) {                                                          \
+                    i++;                                                                                \
+                }                                                                                       \
+                while (less(pivot, data[j])) {                                                          \
+                    j--;                                                                                \
+                }                                                                                       \
+                if (i >= j) {                                                                           \
+                    break;                                                                              \
+                }                                                                                       \
+                tmp = data[i]; data[i] = data[j]; data[j] = tmp;                                        \
+                i++;                                                                                    \
+                j--;                                                                                    \
+            }                                                                                           \
+            /* Recurse into the smaller side and loop on the larger, bounding the stack to O(log n). */ \
+            size_t left = j + 1;                                                                        \
+            if (left < n - left) {                                                                      \
+                arraylist_introsort_##name(data, left, depth);                                          \
+                data += left;                                                                           \
+                n -= left;                                                                              \
+            } else {                                                                                    \
+                arraylist_introsort_##name(data + left, n - left, depth);                               \
+                n = left;                                                                               \
+            }                                                                                           \
+        }                                                                                               \
+        arraylist_insertion_sort_##name(data, n);                                                       \
+    }                                                                                                   \
+                                                                                                        \
+    static inline void arraylist_sort_range_##name(type *data, size_t n) {                              \
+        if (n < 2) {                                                                                    \
+            return;                                                                                     \
+        }                                                                                               \
+        size_t depth = 0;                                                                               \
+        for (size_t m = n; m > 1; m >>= 1) {                                                            \
+            depth += 2;                                                                                 \
+        }                                                                                               \
+        arraylist_introsort_##name(data, n, depth);                                                     \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_sort_<name>(ArrayList_<name> *arraylist)`, which first
+ * unshares the buffer from any snapshot, so the result is `MEMORY_ERROR_<name>` if that copy fails.
+ */
+#define GENERATE_ARRAYLIST_SORT_LIST(name, type)                                             \
+    static inline ArrayListError_##name arraylist_sort_##name(ArrayList_##name *arraylist) { \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                     \
+        if (res != SUCCESS_##name) {                                                         \
+            return res;                                                                      \
+        }                                                                                    \
+        arraylist_sort_range_##name(arraylist->data, arraylist->count);                      \
+        return SUCCESS_##name;                                                               \
+    }
+
+/*
+ * Generates `size_t arraylist_lower_bound_<name>(ArrayList_<name> *arraylist, type value)`,
+ * `size_t arraylist_upper_bound_<name>(ArrayList_<name> *arraylist, type value)` and
+ * `size_t arraylist_binary_search_<name>(ArrayList_<name> *arraylist, type value)`.
+ * The searches expect a list sorted by `less`; `binary_search` returns `ARRAYLIST_NOT_FOUND` on a miss.
+ */
+#define GENERATE_ARRAYLIST_SORT_SEARCH(name, type, less)                                           \
+    static inline size_t arraylist_lower_bound_##name(ArrayList_##name *arraylist, type value) {   \
+        size_t lo = 0;                                                                             \
+        size_t hi = arraylist->count;                                                              \
+        while (lo < hi) {                                                                          \
+            size_t mid = lo + (hi - lo) / 2;                                                       \
+            if (less(arraylist->data[mid], value)) {                                               \
+                lo = mid + 1;                                                                      \
+            } else {                                                                               \
+                hi = mid;                                                                          \
+            }                                                                                      \
+        }                                                                                          \
+        return lo;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    static inline size_t arraylist_upper_bound_##name(ArrayList_##name *arraylist, type value) {   \
+        size_t lo = 0;                                                                             \
+        size_t hi = arraylist->count;                                                              \
+        while (lo < hi) {                                                                          \
+            size_t mid = lo + (hi - lo) / 2;                                                       \
+            if (less(value, arraylist->data[mid])) {                                               \
+                hi = mid;                                                                          \
+            } else {                                                                               \
+                lo = mid + 1;                                                                      \
+            }                                                                                      \
+        }                                                                                          \
+        return lo;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    static inline size_t arraylist_binary_search_##name(ArrayList_##name *arraylist, type value) { \
+        size_t index = arraylist_lower_bound_##name(arraylist, value);                             \
+        if (index < arraylist->count && !less(value, arraylist->data[index])) {                    \
+            return index;                                                                          \
+        }                                                                                          \
+        return ARRAYLIST_NOT_FOUND;                                                                \
+    }
+
+/*
+ * Generates sorting and binary search for an ArrayList already generated with `GENERATE_ARRAYLIST(name, type)`,
+ * ordered by `less(a, b)`.
+ */
+#define GENERATE_ARRAYLIST_SORT(name, type, less)   \
+    GENERATE_ARRAYLIST_SORT_RANGE(name, type, less) \
+    GENERATE_ARRAYLIST_SORT_LIST(name, type)        \
+    GENERATE_ARRAYLIST_SORT_SEARCH(name, type, less)
+
+/*
+ * Generates a priority queue over an ArrayList already generated with `GENERATE_ARRAYLIST(name, type)`:
+ * `ArrayListError_<name> arraylist_heapify_<name>(ArrayList_<name> *arraylist)`,
+ * `ArrayListError_<name> arraylist_heap_push_<name>(ArrayList_<name> *arraylist, type element)`,
+ * `ArrayListError_<name> arraylist_heap_push_batch_<name>(ArrayList_<name> *arraylist, const type *src, size_t n)` and
+ * `ArrayListError_<name> arraylist_heap_pop_<name>(ArrayList_<name> *arraylist, type *out)`.
+ * The list is kept as an `arity`-ary heap with the least element by `less` at index 0. `less` is
+ * expanded inline like in `GENERATE_ARRAYLIST_SORT`. An `arity` of 4 halves the depth of a binary
+ * heap, and a node's children usually share a cache line.
+ */
+#define GENERATE_ARRAYLIST_HEAP(name, type, less, arity)                                            \
+    _Static_assert((arity) >= 2, "GENERATE_ARRAYLIST_HEAP needs an arity of at least 2");           \
+                                                                                                    \
+    static inline void arraylist_heap_sift_up_##name(type *data, size_t index, type element) {      \
+        while (index > 0) {                                                                         \
+            size_t parent = (index - 1) / (arity);                                                  \
+            if (!less(element, data[parent])) {                                                     \
+                break;                                                                              \
+            }                                                                                       \
+            data[index] = data[parent];                                                             \
+            index = parent;                                                                         \
+        }                                                                                           \
+        data[index] = element;                                                                      \
+    }                                                                                               \
+                                                                                                    \
+    static inline void arraylist_heap_sift_down_##name(                                             \
+        type *data, size_t index, size_t n, type element) {                                         \
+        size_t child;                                                                               \
+        while ((child = (arity) * index + 1) < n) {                                                 \
+            size_t end  = n - child > (arity) ? child + (arity) : n;                                \
+            size_t best = child;                                                                    \
+            for (size_t i = child + 1; i < end; i++) {                                              \
+                if (less(data[i], data[best])) {                                                    \
+                    best = i;                                                                       \
+                }                                                                                   \
+            }                                                                                       \
+            if (!less(data[best], element)) {                                                       \
+                break;                                                                              \
+            }                                                                                       \
+            data[index] = data[best];                                                               \
+            index = best;                                                                           \
+        }                                                                                           \
+        data[index] = element;                                                                      \
+    }                                                                                               \
+                                                                                                    \
+    static inline ArrayListError_##name arraylist_heapify_##name(ArrayList_##name *arraylist) {     \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                            \
+        if (res != SUCCESS_##name) {                                                                \
+            return res;                                                                             \
+        }                                                                                           \
+        if (arraylist->count < 2) {                                                                 \
+            return SUCCESS_##name;                                                                  \
+        }                                                                                           \
+        for (size_t i = (arraylist->count - 2) / (arity) + 1; i > 0; i--) {                         \
+            arraylist_heap_sift_down_##name(arraylist->data, i - 1, arraylist->count,               \
+                                            arraylist->data[i - 1]);                                \
+        }                                                                                           \
+        return SUCCESS_##name;                                                                      \
+    }                                                                                               \
+                                                                                                    \
+    static inline ArrayListError_##name arraylist_heap_push_##name(                                 \
+        ArrayList_##name *arraylist, type element) {                                                \
+        if (arraylist->count == arraylist->capacity) {                                              \
+            if (arraylist->capacity == SIZE_MAX) {                                                  \
+                return MEMORY_ERROR_##name;                                                         \
+            }                                                                                       \
+            ArrayListError_##name res =                                                             \
+                arraylist_ensure_capacity_##name(arraylist, arraylist->capacity + 1);               \
+            if (res != SUCCESS_##name) {                                                            \
+                return res;                                                                         \
+            }                                                                                       \
+        }                                                                                           \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                            \
+        if (res != SUCCESS_##name) {                                                                \
+            return res;                                                                             \
+        }                                                                                           \
+        arraylist_heap_sift_up_##name(arraylist->data, arraylist->count, element);                  \
+        arraylist->count += 1;                                                                      \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                  \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                           \
+        return SUCCESS_##name;                                                                      \
+    }                                                                                               \
+                                                                                                    \
+    /* Sifting each new element up costs about n * depth; rebuilding the heap costs about count. */ \
+    static inline ArrayListError_##name arraylist_heap_push_batch_##name(                           \
+        ArrayList_##name *arraylist, const type *src, size_t n) {                                   \
+        if (n == 0) {                                                                               \
+            return SUCCESS_##name;                                                                  \
+        }                                                                                           \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                            \
+        if (res != SUCCESS_##name) {                                                                \
+            return res;                                                                             \
+        }                                                                                           \
+        size_t start = arraylist->count;                                                            \
+        res = arraylist_add_range_##name(arraylist, start, src, n);                                 \
+        if (res != SUCCESS_##name) {                                                                \
+            return res;                                                                             \
+        }                                                                                           \
+        size_t depth = 0;                                                                           \
+        for (size_t m = arraylist->count; m > 0; m /= (arity)) {                                    \
+            depth++;                                                                                \
+        }                                                                                           \
+        if (n > arraylist->count / depth) {                                                         \
+            return arraylist_heapify_##name(arraylist);                                             \
+        }                                                                                           \
+        for (size_t i = start; i < arraylist->count; i++) {                                         \
+            arraylist_heap_sift_up_##name(arraylist->data, i, arraylist->data[i]);                  \
+        }                                                                                           \
+        return SUCCESS_##name;                                                                      \
+    }                                                                                               \
+                                                                                                    \
+    static inline ArrayListError_##name arraylist_heap_pop_##name(                                  \
+        ArrayList_##name *arraylist, type *out) {                                                   \
+        if (arraylist->count == 0) {                                                                \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                    \
+        }                                                                                           \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                            \
+        if (res != SUCCESS_##name) {                                                                \
+            return res;                                                                             \
+        }                                                                                           \
+        if (out != NULL) {                                                                          \
+            *out = arraylist->data[0];                                                              \
+        } else {                                                                                    \
+            arraylist_drop_range_##name(arraylist->data, 1);                                        \
+        }                                                                                           \
+        arraylist->count -= 1;                                                                      \
+        if (arraylist->count > 0) {                                                                 \
+            arraylist_heap_sift_down_##name(arraylist->data, 0, arraylist->count,                   \
+                                            arraylist->data[arraylist->count]);                     \
+        }                                                                                           \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                               \
+        return SUCCESS_##name;                                                                      \
+    }
+
+/*
+ * Generates the vector types and the raw kernels behind `GENERATE_ARRAYLIST_NUMERIC`:
+ * `size_t arraylist_kernel_index_of_<name>(const type *data, size_t n, type value)`,
+ * `size_t arraylist_kernel_count_eq_<name>(const type *data, size_t n, type value)` and
+ * `void arraylist_kernel_minmax_<name>(const type *data, size_t n, type *min, type *max)` (`n > 0`).
+ */
+#define GENERATE_ARRAYLIST_NUMERIC_KERNELS(name, type)                                              \
+    typedef type arraylist_vector_##name __attribute__((vector_size(ARRAYLIST_VECTOR_BYTES)));      \
+    typedef __typeof__((arraylist_vector_##name){0} == (arraylist_vector_##name){0})                \
+        arraylist_mask_##name;                                                                      \
+    typedef unsigned long long arraylist_words_##name                                               \
+        __attribute__((vector_size(ARRAYLIST_VECTOR_BYTES)));                                       \
+    enum { ARRAYLIST_LANES_##name = ARRAYLIST_VECTOR_BYTES / sizeof(type) };                        \
+                                                                                                    \
+    ARRAYLIST_TARGET_CLONES                                                                         \
+    static inline size_t arraylist_kernel_index_of_##name(const type *data, size_t n, type value) { \
+        arraylist_vector_##name needle;                                                             \
+        for (size_t lane = 0; lane < ARRAYLIST_LANES_##name; lane++) {                              \
+            needle[lane] = value;                                                                   \
+        }                                                                                           \
+        size_t i = 0;                                                                               \
+        for (; i + ARRAYLIST_LANES_##name <= n; i += ARRAYLIST_LANES_##name) {                      \
+            arraylist_vector_##name block;                                                          \
+            memcpy(&block, &data[i], sizeof(block));                                                \
+            arraylist_words_##name hits = (arraylist_words_##name)(block == needle);                \
+            unsigned long long any = 0;                                                             \
+            for (size_t word = 0; word < ARRAYLIST_VECTOR_BYTES / sizeof(any); word++) {            \
+                any |= hits[word];                                                                  \
+            }                                                                                       \
+            if (any != 0) {                                                                         \
+                break;                                                                              \
+            }                                                                                       \
+        }                                                                                           \
+        for (; i < n; i++) {                                                                        \
+            if (data[i] == value) {                                                                 \
+                return i;                                                                           \
+            }                                                                                       \
+        }                                                                                           \
+        return ARRAYLIST_NOT_FOUND;                                                                 \
+    }                                                                                               \
+                                                                                                    \
+    ARRAYLIST_TARGET_CLONES                                                                         \
+    static inline size_t arraylist_kernel_count_eq_##name(const type *data, size_t n, type value) { \
+        arraylist_vector_##name needle;                                                             \
+        for (size_t lane = 0; lane < ARRAYLIST_LANES_##name; lane++) {                              \
+            needle[lane] = value;                                                                   \
+        }                                                                                           \
+        size_t total = 0;                                                                           \
+        size_t i = 0;                                                                               \
+        while (i + ARRAYLIST_LANES_##name <= n) {                                                   \
+            /* Each lane counts at most 127 matches, so it fits even for 1-byte types. */           \
+            arraylist_mask_##name counts;                                                           \
+            memset(&counts, 0, sizeof(counts));                                                     \
+            for (size_t round = 0; round < 127 && i + ARRAYLIST_LANES_##name <= n;                  \
+                 round++, i += ARRAYLIST_LANES_##name) {                                            \
+                arraylist_vector_##name block;                                                      \
+                memcpy(&block, &data[i], sizeof(block));                                            \
+                counts -= (block == needle);                                                        \
+            }                                                                                       \
+            for (size_t lane = 0; lane < ARRAYLIST_LANES_##name; lane++) {                          \
+                total += (size_t)counts[lane];                                                      \
+            }                                                                                       \
+        }                                                                                           \
+        for (; i < n; i++) {                                                                        \
+            total += data[i] == value;                                                              \
+        }                                                                                           \
+        return total;                                                                               \
+    }                                                                                               \
+                                                                                                    \
+    ARRAYLIST_TARGET_CLONES                                                                         \
+    static inline void arraylist_kernel_minmax_##name(                                              \
+        const type *data, size_t n, type *min, type *max) {                                         \
+        type lo = data[0];                                                                          \
+        type hi = data[0];                                                                          \
+        size_t i = 0;                                                                               \
+        if (n >= ARRAYLIST_LANES_##name) {                                                          \
+            arraylist_vector_##name vlo;                                                            \
+            arraylist_vector_##name vhi;                                                            \
+            memcpy(&vlo, data, sizeof(vlo));                                                        \
+            vhi = vlo;                                                                              \
+            for (i = ARRAYLIST_LANES_##name; i + ARRAYLIST_LANES_##name <= n;                       \
+                 i += ARRAYLIST_LANES_##name) {                                                     \
+                arraylist_vector_##name block;                                                      \
+                memcpy(&block, &data[i], sizeof(block));                                            \
+                /* Blend through the integer mask, since C has no vector `?:`. */                   \
+                arraylist_mask_##name lt = block < vlo;                                             \
+                arraylist_mask_##name gt = block > vhi;                                             \
+                vlo = (arraylist_vector_##name)(((arraylist_mask_##name)block & lt) |               \
+                                                ((arraylist_mask_##name)vlo & ~lt));                \
+                vhi = (arraylist_vector_##name)(((arraylist_mask_##name)block & gt) |               \
+                                                ((arraylist_mask_##name)vhi & ~gt));                \
+            }                                                                                       \
+            lo = vlo[0];                                                                            \
+            hi = vhi[0];                                                                            \
+            for (size_t lane = 1; lane < ARRAYLIST_LANES_##name; lane++) {                          \
+                lo = vlo[lane] < lo ? vlo[lane] : lo;                                               \
+                hi = vhi[lane] > hi ? vhi[lane] : hi;                                               \
+            }                                                                                       \
+        }                                                                                           \
+        for (; i < n; i++) {                                                                        \
+            lo = data[i] < lo ? data[i] : lo;                                                       \
+            hi = data[i] > hi ? data[i] : hi;                                                       \
+        }                                                                                           \
+        if (min != NULL) {                                                                          \
+            *min = lo;                                                                              \
+        }                                                                                           \
+        if (max != NULL) {                                                                          \
+            *max = hi;                                                                              \
+        }                                                                                           \
+    }
+
+/*
+ * Generates `size_t arraylist_index_of_<name>(ArrayList_<name> *arraylist, type value)`,
+ * `bool arraylist_contains_<name>(ArrayList_<name> *arraylist, type value)`,
+ * `size_t arraylist_count_eq_<name>(ArrayList_<name> *arraylist, type value)` and
+ * `ArrayListError_<name> arraylist_minmax_<name>(ArrayList_<name> *arraylist, type *min, type *max)`.
+ */
+#define GENERATE_ARRAYLIST_NUMERIC_SEARCH(name, type)                                         \
+    static inline size_t arraylist_index_of_##name(ArrayList_##name *arraylist, type value) { \
+        return arraylist_kernel_index_of_##name(arraylist->data, arraylist->count, value);    \
+    }                                                                                         \
+                                                                                              \
+    static inline bool arraylist_contains_##name(ArrayList_##name *arraylist, type value) {   \
+        return arraylist_index_of_##name(arraylist, value) != ARRAYLIST_NOT_FOUND;            \
+    }                                                                                         \
+                                                                                              \
+    static inline size_t arraylist_count_eq_##name(ArrayList_##name *arraylist, type value) { \
+        return arraylist_kernel_count_eq_##name(arraylist->data, arraylist->count, value);    \
+    }                                                                                         \
+                                                                                              \
+    static inline ArrayListError_##name arraylist_minmax_##name(                              \
+        ArrayList_##name *arraylist, type *min, type *max) {                                  \
+        if (arraylist->count == 0) {                                                          \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                              \
+        }                                                                                     \
+        arraylist_kernel_minmax_##name(arraylist->data, arraylist->count, min, max);          \
+        return SUCCESS_##name;                                                                \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_radix_sort_<name>(ArrayList_<name> *arraylist)`,
+ * an LSD radix sort over 8-bit digits for numeric `type`. Keys are mapped to unsigned integers
+ * that order like the values: the sign bit is flipped for signed integers, and for floats all
+ * bits are flipped when negative. NaNs sort after +infinity (or before -infinity if negative).
+ * Digits on which every key agrees are skipped. Needs one scratch buffer of `count` elements,
+ * from the list's allocator.
+ */
+#define GENERATE_ARRAYLIST_RADIX_SORT(name, type)                                                  \
+    static inline unsigned long long arraylist_radix_key_##name(type value) {                      \
+        unsigned long long bits;                                                                   \
+        unsigned long long sign = 1ULL << (sizeof(type) * CHAR_BIT - 1);                           \
+        if (sizeof(type) == 1) {                                                                   \
+            unsigned char b; memcpy(&b, &value, 1); bits = b;                                      \
+        } else if (sizeof(type) == 2) {                                                            \
+            uint16_t b; memcpy(&b, &value, 2); bits = b;                                           \
+        } else if (sizeof(type) == 4) {                                                            \
+            uint32_t b; memcpy(&b, &value, 4); bits = b;                                           \
+        } else {                                                                                   \
+            uint64_t b; memcpy(&b, &value, 8); bits = b;                                           \
+        }                                                                                          \
+        if ((type)0.5 != 0) {                                                                      \
+            unsigned long long all = sign | (sign - 1);                                            \
+            return (bits & sign) ? (~bits & all) : (bits | sign);                                  \
+        }                                                                                          \
+        if ((type)-1 < (type)1) {                                                                  \
+            return bits ^ sign;                                                                    \
+        }                                                                                          \
+        return bits;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static inline ArrayListError_##name arraylist_radix_sort_##name(ArrayList_##name *arraylist) { \
+        size_t n = arraylist->count;                                                               \
+        if (n < 2) {                                                                               \
+            return SUCCESS_##name;                                                                 \
+        }                                                                                          \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                           \
+        if (res != SUCCESS_##name) {                                                               \
+            return res;                                                                            \
+        }                                                                                          \
+        type *scratch = arraylist_allocate(arraylist->allocator, n * sizeof(type));                \
+        if (scratch == NULL) {                                                                     \
+            return MEMORY_ERROR_##name;                                                            \
+        }                                                                                          \
+        size_t counts[sizeof(type)][256];                                                          \
+        memset(counts, 0, sizeof(counts));                                                         \
+        for (size_t i = 0; i < n; i++) {                                                           \
+            unsigned long long key = arraylist_radix_key_##name(arraylist->data[i]);               \
+            for (size_t digit = 0; digit < sizeof(type); digit++) {                                \
+                counts[digit][(key >> (digit * 8)) & 0xff]++;                                      \
+            }                                                                                      \
+        }                                                                                          \
+        type *src = arraylist->data;                                                               \
+        type *dst = scratch;                                                                       \
+        for (size_t digit = 0; digit < sizeof(type); digit++) {                                    \
+            unsigned long long first = (arraylist_radix_key_##name(src[0]) >> (digit * 8)) & 0xff; \
+            if (counts[digit][first] == n) {                                                       \
+                continue;                                                                          \
+            }                                                                                      \
+            size_t offset = 0;                                                                     \
+            for (size_t bucket = 0; bucket < 256; bucket++) {                                      \
+                size_t c = counts[digit][bucket];                                                  \
+                counts[digit][bucket] = offset;                                                    \
+                offset += c;                                                                       \
+            }                                                                                      \
+            for (size_t i = 0; i < n; i++) {                                                       \
+                unsigned long long key = arraylist_radix_key_##name(src[i]);                       \
+                dst[counts[digit][(key >> (digit * 8)) & 0xff]++] = src[i];                        \
+            }                                                                                      \
+            type *tmp = src;                                                                       \
+            src = dst;                                                                             \
+            dst = tmp;                                                                             \
+        }                                                                                          \
+        if (src != arraylist->data) {                                                              \
+            memcpy(arraylist->data, src, n * sizeof(type));                                        \
+        }                                                                                          \
+        arraylist_deallocate(arraylist->allocator, scratch, n * sizeof(type));                     \
+        return SUCCESS_##name;                                                                     \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_write_varint_fd_<name>(ArrayList_<name> *arraylist, int fd)`
+ * and `ArrayListError_<name> arraylist_read_varint_fd_<name>(ArrayList_<name> *arraylist, int fd)` for an
+ * ArrayList already generated with `GENERATE_ARRAYLIST(name, type)`, where `type` is an integer type
+ * of at most 8 bytes. They work like `arraylist_write_fd_<name>` and `arraylist_read_fd_<name>`, but
+ * send each element as a varint of its zigzag-encoded difference from the one before, so sorted or
+ * slowly changing values take a byte or two each.
+ */
+#define GENERATE_ARRAYLIST_VARINT(name, type)                                                     \
+    _Static_assert((type)0.5 == 0 && sizeof(type) <= 8,                                           \
+                   "GENERATE_ARRAYLIST_VARINT needs an integer type of at most 8 bytes");         \
+                                                                                                  \
+    static inline uint64_t arraylist_varint_key_##name(type value) {                              \
+        return (type)-1 < (type)1 ? (uint64_t)(int64_t)value : (uint64_t)value;                   \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_write_varint_fd_##name(                         \
+        ArrayList_##name *arraylist, int fd) {                                                    \
+        uint64_t bytes = 0;                                                                       \
+        uint64_t prev  = 0;                                                                       \
+        for (size_t i = 0; i < arraylist->count; i++) {                                           \
+            uint64_t key = arraylist_varint_key_##name(arraylist->data[i]);                       \
+            bytes += arraylist_varint_size(arraylist_zigzag(key - prev));                         \
+            prev = key;                                                                           \
+        }                                                                                         \
+        ArrayListFileHeader header;                                                               \
+        arraylist_file_header_init(&header, sizeof(type), arraylist->count);                      \
+        header.encoding      = ARRAYLIST_ENCODING_DELTA_VARINT;                                   \
+        header.encoded_bytes = bytes;                                                             \
+        uint8_t *buf = arraylist_allocate(arraylist->allocator, ARRAYLIST_STREAM_CHUNK);          \
+        if (buf == NULL) {                                                                        \
+            return MEMORY_ERROR_##name;                                                           \
+        }                                                                                         \
+        bool   ok   = arraylist_write_parts(fd, &header, sizeof(header), NULL, 0);                \
+        size_t used = 0;                                                                          \
+        prev = 0;                                                                                 \
+        for (size_t i = 0; ok && i < arraylist->count; i++) {                                     \
+            if (used > ARRAYLIST_STREAM_CHUNK - ARRAYLIST_VARINT_MAX) {                           \
+                ok   = arraylist_write_parts(fd, buf, used, NULL, 0);                             \
+                used = 0;                                                                         \
+            }                                                                                     \
+            uint64_t key = arraylist_varint_key_##name(arraylist->data[i]);                       \
+            used += arraylist_varint_put(buf + used, arraylist_zigzag(key - prev));               \
+            prev = key;                                                                           \
+        }                                                                                         \
+        ok = ok && arraylist_write_parts(fd, buf, used, NULL, 0);                                 \
+        arraylist_deallocate(arraylist->allocator, buf, ARRAYLIST_STREAM_CHUNK);                  \
+        return ok ? SUCCESS_##name : IO_ERROR_##name;                                             \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_read_varint_fd_##name(                          \
+        ArrayList_##name *arraylist, int fd) {                                                    \
+        ArrayListFileHeader header;                                                               \
+        if (!arraylist_read_header(fd, &header, sizeof(type), ARRAYLIST_ENCODING_DELTA_VARINT)) { \
+            return IO_ERROR_##name;                                                               \
+        }                                                                                         \
+        size_t   n         = (size_t)header.count;                                                \
+        uint64_t remaining = header.encoded_bytes;                                                \
+        size_t   new_count;                                                                       \
+        if (remaining < n || remaining / ARRAYLIST_VARINT_MAX > n) {                              \
+            errno = EINVAL;                                                                       \
+            return IO_ERROR_##name;                                                               \
+        }                                                                                         \
+        if (__builtin_add_overflow(arraylist->count, n, &new_count)) {                            \
+            return MEMORY_ERROR_##name;                                                           \
+        }                                                                                         \
+        ArrayListError_##name res = arraylist_reserve_##name(arraylist, new_count);               \
+        if (res != SUCCESS_##name) {                                                              \
+            return res;                                                                           \
+        }                                                                                         \
+        uint8_t *buf = arraylist_allocate(arraylist->allocator, ARRAYLIST_STREAM_CHUNK);          \
+        if (buf == NULL) {                                                                        \
+            return MEMORY_ERROR_##name;                                                           \
+        }                                                                                         \
+        size_t   have = 0;                                                                        \
+        size_t   pos  = 0;                                                                        \
+        uint64_t prev = 0;                                                                        \
+        bool     ok   = true;                                                                     \
+        for (size_t i = 0; ok && i < n; i++) {                                                    \
+            if (have - pos < ARRAYLIST_VARINT_MAX && remaining > 0) {                             \
+                memmove(buf, buf + pos, have - pos);                                              \
+                have -= pos;                                                                      \
+                pos = 0;                                                                          \
+                size_t want = ARRAYLIST_STREAM_CHUNK - have;                                      \
+                if (want > remaining) {                                                           \
+                    want = (size_t)remaining;                                                     \
+                }                                                                                 \
+                ok = arraylist_read_all(fd, buf + have, want);                                    \
+                have += want;                                                                     \
+                remaining -= want;                                                                \
+            }                                                                                     \
+            uint64_t zigzag;                                                                      \
+            size_t size = ok ? arraylist_varint_get(buf + pos, have - pos, &zigzag) : 0;          \
+            if (size == 0) {                                                                      \
+                if (ok) {                                                                         \
+                    errno = EINVAL;                                                               \
+                }                                                                                 \
+                ok = false;                                                                       \
+                break;                                                                            \
+            }                                                                                     \
+            pos += size;                                                                          \
+            prev += arraylist_unzigzag(zigzag);                                                   \
+            arraylist->data[arraylist->count + i] = (type)prev;                                   \
+        }                                                                                         \
+        if (ok && (remaining > 0 || pos != have)) {                                               \
+            errno = EINVAL;                                                                       \
+            ok = false;                                                                           \
+        }                                                                                         \
+        arraylist_deallocate(arraylist->allocator, buf, ARRAYLIST_STREAM_CHUNK);                  \
+        if (!ok) {                                                                                \
+            return IO_ERROR_##name;                                                               \
+        }                                                                                         \
+        arraylist->count = new_count;                                                             \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, n);                                                \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                         \
+        return SUCCESS_##name;                                                                    \
+    }
+
+/*
+ * Generates SIMD search functions and a radix sort for an ArrayList already generated with
+ * `GENERATE_ARRAYLIST(name, type)`, where `type` is an integer or floating-point type of at most 8 bytes.
+ */
+#define GENERATE_ARRAYLIST_NUMERIC(name, type)     \
+    GENERATE_ARRAYLIST_NUMERIC_KERNELS(name, type) \
+    GENERATE_ARRAYLIST_NUMERIC_SEARCH(name, type)  \
+    GENERATE_ARRAYLIST_RADIX_SORT(name, type)
+
+/*
+ * Generates `ArrayListError_<name> arraylist_parallel_for_<name>(ArrayList_<name> *arraylist,
+ * void (*fn)(type *chunk, size_t n, void *ctx), void *ctx, size_t nthreads)` and
+ * `arraylist_parallel_for_with_executor_<name>`, which takes an `ArrayListExecutor *` instead of
+ * `nthreads`. `fn` is called once per chunk, concurrently; a `nthreads` of 0 uses every online CPU.
+ * `fn` may write to its chunk, so the buffer is first unshared from any snapshot.
+ */
+#define GENERATE_ARRAYLIST_PARALLEL_FOR(name, type)                                                                              \
+    typedef struct arraylist_parallel_for_##name##_t {                                                                           \
+        type *data;                                                                                                              \
+        size_t count;                                                                                                            \
+        size_t chunk;                                                                                                            \
+        void (*fn)(type *chunk, size_t n, void *ctx);                                                                            \
+        void *ctx;                                                                                                               \
+    } ArrayListParallelFor_##name;                                                                                               \
+                                                                                                                                 \
+    static inline void arraylist_parallel_for_task_##name(void *arg, size_t index) {                                             \
+        ArrayListParallelFor_##name *job = arg;                                                                                  \
+        size_t begin = index * job->chunk;                                                                                       \
+        size_t n = job->count - begin < job->chunk ? job->count - begin : job->chunk;                                            \
+        job->fn(job->data + begin, n, job->ctx);                                                                                 \
+    }                                                                                                                            \
+                                                                                                                                 \
+    static inline ArrayListError_##name arraylist_parallel_for_with_executor_##name(                                             \
+        ArrayList_##name *arraylist, void (*fn)(type *chunk, size_t n, void *ctx), void *ctx, ArrayListExecutor *executor) {     \
+        ArrayListExecutor fallback;                                                                                              \
+        executor = arraylist_resolve_executor(executor, &fallback);                                                              \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                                                         \
+        if (res != SUCCESS_##name) {                                                                                             \
+            return res;                                                                                                          \
+        }                                                                                                                        \
+        ArrayListParallelFor_##name job = { arraylist->data, arraylist->count, 0, fn, ctx };                                     \
+        size_t nchunks = arraylist_parallel_chunks(job.count, sizeof(type), executor->nthreads, &job.chunk);                     \
+        if (nchunks == 1) {                                                                                                      \
+            fn(job.data, job.count, ctx);                                                                                        \
+        } else if (nchunks > 1) {                                                                                                \
+            executor->run(executor, nchunks, arraylist_parallel_for_task_##name, &job);                                          \
+        }                                                                                                                        \
+        return SUCCESS_##name;                                                                                                   \
+    }                                                                                                                            \
+                                                                                                                                 \
+    static inline ArrayListError_##name arraylist_parallel_for_##name(                                                           \
+        ArrayList_##name *arraylist, void (*fn)(type *chunk, size_t n, void *ctx), void *ctx, size_t nthreads) {                 \
+        ArrayListExecutor executor;                                                                                              \
+        return arraylist_parallel_for_with_executor_##name(arraylist, fn, ctx, arraylist_default_executor(&executor, nthreads)); \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_parallel_reduce_<name>(ArrayList_<name> *arraylist,
+ * type (*reduce)(const type *chunk, size_t n, void *ctx), type (*combine)(type a, type b, void *ctx),
+ * void *ctx, size_t nthreads, type *out)` and `arraylist_parallel_reduce_with_executor_<name>`.
+ * Each chunk is reduced concurrently, then the partial results are combined in chunk order on the
+ * calling thread, so `combine` only needs to be associative. The partial results take one
+ * allocation from the list's allocator.
+ */
+#define GENERATE_ARRAYLIST_PARALLEL_REDUCE(name, type)                                                               \
+    typedef struct arraylist_parallel_reduce_##name##_t {                                                            \
+        const type *data;                                                                                            \
+        size_t count;                                                                                                \
+        size_t chunk;                                                                                                \
+        type (*reduce)(const type *chunk, size_t n, void *ctx);                                                      \
+        void *ctx;                                                                                                   \
+        unsigned char *partial; /* one result per chunk, `stride` bytes apart */                                     \
+        size_t stride;                                                                                               \
+    } ArrayListParallelReduce_##name;                                                                                \
+                                                                                                                     \
+    static inline void arraylist_parallel_reduce_task_##name(void *arg, size_t index) {                              \
+        ArrayListParallelReduce_##name *job = arg;                                                                   \
+        size_t begin = index * job->chunk;                                                                           \
+        size_t n = job->count - begin < job->chunk ? job->count - begin : job->chunk;                                \
+        *(type *)(job->partial + index * job->stride) = job->reduce(job->data + begin, n, job->ctx);                 \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline ArrayListError_##name arraylist_parallel_reduce_with_executor_##name(                              \
+        ArrayList_##name *arraylist, type (*reduce)(const type *chunk, size_t n, void *ctx),                         \
+        type (*combine)(type a, type b, void *ctx), void *ctx, ArrayListExecutor *executor, type *out) {             \
+        ArrayListExecutor fallback;                                                                                  \
+        executor = arraylist_resolve_executor(executor, &fallback);                                                  \
+        if (arraylist->count == 0) {                                                                                 \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                                     \
+        }                                                                                                            \
+        size_t chunk;                                                                                                \
+        size_t nchunks = arraylist_parallel_chunks(arraylist->count, sizeof(type), executor->nthreads, &chunk);      \
+        if (nchunks == 1) {                                                                                          \
+            *out = reduce(arraylist->data, arraylist->count, ctx);                                                   \
+            return SUCCESS_##name;                                                                                   \
+        }                                                                                                            \
+        /* Each result gets its own cache lines, so the chunks' writes do not contend. */                            \
+        size_t stride = (sizeof(type) + ARRAYLIST_CACHE_LINE - 1) & ~((size_t)ARRAYLIST_CACHE_LINE - 1);             \
+        size_t bytes = nchunks * stride + ARRAYLIST_CACHE_LINE - 1;                                                  \
+        unsigned char *buffer = arraylist_allocate(arraylist->allocator, bytes);                                     \
+        if (buffer == NULL) {                                                                                        \
+            return MEMORY_ERROR_##name;                                                                              \
+        }                                                                                                            \
+        ArrayListParallelReduce_##name job;                                                                          \
+        job.data = arraylist->data;                                                                                  \
+        job.count = arraylist->count;                                                                                \
+        job.chunk = chunk;                                                                                           \
+        job.reduce = reduce;                                                                                         \
+        job.ctx = ctx;                                                                                               \
+        job.partial = buffer + (-(uintptr_t)buffer & (ARRAYLIST_CACHE_LINE - 1));                                    \
+        job.stride = stride;                                                                                         \
+        executor->run(executor, nchunks, arraylist_parallel_reduce_task_##name, &job);                               \
+        type result = *(type *)job.partial;                                                                          \
+        for (size_t i = 1; i < nchunks; i++) {                                                                       \
+            result = combine(result, *(type *)(job.partial + i * stride), ctx);                                      \
+        }                                                                                                            \
+        arraylist_deallocate(arraylist->allocator, buffer, bytes);                                                   \
+        *out = result;                                                                                               \
+        return SUCCESS_##name;                                                                                       \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline ArrayListError_##name arraylist_parallel_reduce_##name(                                            \
+        ArrayList_##name *arraylist, type (*reduce)(const type *chunk, size_t n, void *ctx),                         \
+        type (*combine)(type a, type b, void *ctx), void *ctx, size_t nthreads, type *out) {                         \
+        ArrayListExecutor executor;                                                                                  \
+        return arraylist_parallel_reduce_with_executor_##name(arraylist, reduce, combine, ctx,                       \
+                                                              arraylist_default_executor(&executor, nthreads), out); \
+    }
+
+/*
+ * Generates the parallel loops for an ArrayList already generated with `GENERATE_ARRAYLIST(name, type)`.
+ */
+#define GENERATE_ARRAYLIST_PARALLEL(name, type) \
+    GENERATE_ARRAYLIST_PARALLEL_FOR(name, type) \
+    GENERATE_ARRAYLIST_PARALLEL_REDUCE(name, type)
+
+/*
+ * Generates `ArrayListError_<name> arraylist_parallel_sort_<name>(ArrayList_<name> *arraylist, size_t nthreads)`
+ * and `arraylist_parallel_sort_with_executor_<name>`. Chunks are introsorted concurrently, then merged
+ * pairwise in rounds, each round's merges running concurrently, through one scratch buffer of `count`
+ * elements from the list's allocator. Requires `GENERATE_ARRAYLIST_SORT(name, type, less)` with the same `less`.
+ */
+#define GENERATE_ARRAYLIST_PARALLEL_SORT(name, type, less)                                                               \
+    typedef struct arraylist_parallel_sort_##name##_t {                                                                  \
+        type *src;                                                                                                       \
+        type *dst;                                                                                                       \
+        size_t count;                                                                                                    \
+        size_t run;                                                                                                      \
+    } ArrayListParallelSort_##name;                                                                                      \
+                                                                                                                         \
+    static inline void arraylist_parallel_sort_task_##name(void *arg, size_t index) {                                    \
+        ArrayListParallelSort_##name *job = arg;                                                                         \
+        size_t begin = index * job->run;                                                                                 \
+        size_t n = job->count - begin < job->run ? job->count - begin : job->run;                                        \
+        arraylist_sort_range_##name(job->src + begin, n);                                                                \
+    }                                                                                                                    \
+                                                                                                                         \
+    static inline void arraylist_parallel_merge_task_##name(void *arg, size_t index) {                                   \
+        ArrayListParallelSort_##name *job = arg;                                                                         \
+        size_t begin = index * 2 * job->run;                                                                             \
+        size_t mid = job->count - begin < job->run ? job->count : begin + job->run;                                      \
+        size_t end = job->count - mid < job->run ? job->count : mid + job->run;                                          \
+        const type *src = job->src;                                                                                      \
+        type *dst = job->dst;                                                                                            \
+        size_t i = begin;                                                                                                \
+        size_t j = mid;                                                                                                  \
+        size_t k = begin;                                                                                                \
+        while (i < mid && j < end) {                                                                                     \
+            dst[k++] = less(src[j], src[i]) ? src[j++] : src[i++];                                                       \
+        }                                                                                                                \
+        memcpy(dst + k, src + i, (mid - i) * sizeof(type));                                                              \
+        k += mid - i;                                                                                                    \
+        memcpy(dst + k, src + j, (end - j) * sizeof(type));                                                              \
+    }                                                                                                                    \
+                                                                                                                         \
+    static inline ArrayListError_##name arraylist_parallel_sort_with_executor_##name(ArrayList_##name *arraylist,        \
+                                                                                      ArrayListExecutor *executor) {     \
+        ArrayListExecutor fallback;                                                                                      \
+        executor = arraylist_resolve_executor(executor, &fallback);                                                      \
+        ArrayListError_##name res = arraylist_unshare_##name(arraylist);                                                 \
+        if (res != SUCCESS_##name) {                                                                                     \
+            return res;                                                                                                  \
+        }                                                                                                                \
+        ArrayListParallelSort_##name job = { arraylist->data, NULL, arraylist->count, 0 };                               \
+        size_t nchunks = arraylist_parallel_chunks(job.count, sizeof(type), executor->nthreads, &job.run);               \
+        if (nchunks <= 1) {                                                                                              \
+            arraylist_sort_range_##name(job.src, job.count);                                                             \
+            return SUCCESS_##name;                                                                                       \
+        }                                                                                                                \
+        job.dst = arraylist_allocate(arraylist->allocator, job.count * sizeof(type));                                    \
+        if (job.dst == NULL) {                                                                                           \
+            return MEMORY_ERROR_##name;                                                                                  \
+        }                                                                                                                \
+        type *scratch = job.dst;                                                                                         \
+        executor->run(executor, nchunks, arraylist_parallel_sort_task_##name, &job);                                     \
+        for (; nchunks > 1; nchunks = nchunks / 2 + nchunks % 2) {                                                       \
+            executor->run(executor, nchunks / 2 + nchunks % 2, arraylist_parallel_merge_task_##name, &job);              \
+            type *tmp = job.src;                                                                                         \
+            job.src = job.dst;                                                                                           \
+            job.dst = tmp;                                                                                               \
+            job.run *= 2;                                                                                                \
+        }                                                                                                                \
+        if (job.src != arraylist->data) {                                                                                \
+            memcpy(arraylist->data, job.src, job.count * sizeof(type));                                                  \
+        }                                                                                                                \
+        arraylist_deallocate(arraylist->allocator, scratch, job.count * sizeof(type));                                   \
+        return SUCCESS_##name;                                                                                           \
+    }                                                                                                                    \
+                                                                                                                         \
+    static inline ArrayListError_##name arraylist_parallel_sort_##name(ArrayList_##name *arraylist, size_t nthreads) {   \
+        ArrayListExecutor executor;                                                                                      \
+        return arraylist_parallel_sort_with_executor_##name(arraylist, arraylist_default_executor(&executor, nthreads)); \
+    }
+
+/*
+ * Generates `struct small_arraylist_<name>_t` and
+ * `ArrayList_<name> *arraylist_small_init_<name>(SmallArrayList_<name> *small)`.
+ * The returned list keeps its first `n` elements inside `small`, and moves them
+ * to the heap once it outgrows them. Release it with `arraylist_deinit_<name>`,
+ * and do not copy or move `small` while the list is in use.
+ */
+#define GENERATE_SMALL_ARRAYLIST_STRUCT(name, type, n)                                          \
+    typedef struct small_arraylist_##name##_t {                                                 \
+        ArrayList_##name list;                                                                  \
+        type             storage[n];                                                            \
+    } SmallArrayList_##name;                                                                    \
+                                                                                                \
+    static inline ArrayList_##name *arraylist_small_init_##name(SmallArrayList_##name *small) { \
+        arraylist_init_##name(&small->list);                                                    \
+        small->list.data     = small->storage;                                                  \
+        small->list.capacity = n;                                                               \
+        small->list.storage  = ARRAYLIST_STORAGE_INLINE;                                        \
+        return &small->list;                                                                    \
+    }
+
+/*
+ * Generates the full implementation of an ArrayList suffixed by `name` for a given `type`,
+ * plus `SmallArrayList_<name>` with room for `n` elements inline.
+ */
+#define GENERATE_SMALL_ARRAYLIST(name, type, n) \
+    GENERATE_ARRAYLIST(name, type)              \
+    GENERATE_SMALL_ARRAYLIST_STRUCT(name, type, n)
+
+/*
+ * Generate `struct arraylist_<name>_t` for a list of at most `n` elements stored inline, and
+ * `ARRAYLIST_CAPACITY_<name>`, the constant `n`.
+ */
+#define GENERATE_FIXED_ARRAYLIST_STRUCT(name, type, n) \
+    typedef struct arraylist_##name##_t {              \
+        size_t count;                                  \
+        type   data[n];                                \
+        ARRAYLIST_STATS_MEMBER                         \
+    } ArrayList_##name;                                \
+                                                       \
+    enum { ARRAYLIST_CAPACITY_##name = n };
+
+/*
+ * Generates the fixed versions of `arraylist_init_<name>`, `arraylist_deinit_<name>`,
+ * `arraylist_capacity_<name>` and `arraylist_clear_<name>`. There is nothing to free, so deinit only
+ * empties the list.
+ */
+#define GENERATE_FIXED_ARRAYLIST_LIFETIME(name)                                   \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {       \
+        arraylist->count = 0;                                                     \
+        ARRAYLIST_STATS_RESET(arraylist);                                         \
+    }                                                                             \
+                                                                                  \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) {     \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                    \
+        arraylist_init_##name(arraylist);                                         \
+    }                                                                             \
+                                                                                  \
+    static inline size_t arraylist_capacity_##name(ArrayList_##name *arraylist) { \
+        (void)arraylist;                                                          \
+        return ARRAYLIST_CAPACITY_##name;                                         \
+    }                                                                             \
+                                                                                  \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) {      \
+        arraylist->count = 0;                                                     \
+    }
+
+/*
+ * Generates the fixed versions of `arraylist_set_<name>`, `arraylist_add_<name>`,
+ * `arraylist_add_range_<name>`, `arraylist_remove_<name>` and `arraylist_swap_remove_<name>`.
+ * Adding to a full list returns `MEMORY_ERROR_<name>` and changes nothing.
+ */
+#define GENERATE_FIXED_ARRAYLIST_MODIFY(name, type)                                                     \
+    static inline ArrayListError_##name arraylist_set_##name(                                           \
+        ArrayList_##name *arraylist, size_t index, type new_element, type *out) {                       \
+        if (arraylist->count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                        \
+        }                                                                                               \
+        if (index >= arraylist->count) {                                                                \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (out != NULL) {                                                                              \
+            *out = arraylist->data[index];                                                              \
+        }                                                                                               \
+        arraylist->data[index] = new_element;                                                           \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_add_##name(                                           \
+        ArrayList_##name *arraylist, size_t index, type element) {                                      \
+        if (index > arraylist->count) {                                                                 \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (arraylist->count == ARRAYLIST_CAPACITY_##name) {                                            \
+            return MEMORY_ERROR_##name;                                                                 \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                      \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index) * sizeof(type));     \
+        memmove(&arraylist->data[index + 1], &arraylist->data[index],                                   \
+                (arraylist->count - index) * sizeof(type));                                             \
+        arraylist->data[index] = element;                                                               \
+        arraylist->count += 1;                                                                          \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_add_range_##name(                                     \
+        ArrayList_##name *arraylist, size_t index, const type *src, size_t n) {                         \
+        if (index > arraylist->count) {                                                                 \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (n > ARRAYLIST_CAPACITY_##name - arraylist->count) {                                         \
+            return MEMORY_ERROR_##name;                                                                 \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, n);                                                      \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index) * sizeof(type));     \
+        memmove(&arraylist->data[index + n], &arraylist->data[index],                                   \
+                (arraylist->count - index) * sizeof(type));                                             \
+        memcpy(&arraylist->data[index], src, n * sizeof(type));                                         \
+        arraylist->count += n;                                                                          \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_remove_##name(                                        \
+        ArrayList_##name *arraylist, size_t index, type *out) {                                         \
+        if (arraylist->count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                        \
+        }                                                                                               \
+        if (index >= arraylist->count) {                                                                \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (out != NULL) {                                                                              \
+            *out = arraylist->data[index];                                                              \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                   \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index - 1) * sizeof(type)); \
+        memmove(&arraylist->data[index], &arraylist->data[index + 1],                                   \
+                (arraylist->count - index - 1) * sizeof(type));                                         \
+        arraylist->count -= 1;                                                                          \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_swap_remove_##name(                                   \
+        ArrayList_##name *arraylist, size_t index, type *out) {                                         \
+        if (arraylist->count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                        \
+        }                                                                                               \
+        if (index >= arraylist->count) {                                                                \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (out != NULL) {                                                                              \
+            *out = arraylist->data[index];                                                              \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                   \
+        arraylist->count -= 1;                                                                          \
+        arraylist->data[index] = arraylist->data[arraylist->count];                                     \
+        return SUCCESS_##name;                                                                          \
+    }
+
+/*
+ * Generates an ArrayList suffixed by `name` for a given `type` that holds at most `n` elements
+ * inside the structure itself. It never allocates, has no growth path, and its capacity is the
+ * compile-time constant `ARRAYLIST_CAPACITY_<name>`, so the compiler can fold bounds and sizes.
+ * Elements are copied with `memcpy`/`memmove`, so `type` must need no element hooks.
+ * It provides init/deinit, count/capacity/is_empty, get/set/get_first/get_last, at_unchecked,
+ * data/end, iterators, clear, add/add_range/add_first/add_last and remove/remove_first/remove_last/swap_remove.
+ */
+#define GENERATE_FIXED_ARRAYLIST(name, type, n)    \
+    GENERATE_FIXED_ARRAYLIST_STRUCT(name, type, n) \
+    GENERATE_ARRAYLIST_STATS(name)                 \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)            \
+    GENERATE_FIXED_ARRAYLIST_LIFETIME(name)        \
+    GENERATE_ARRAYLIST_COUNT(name)                 \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)              \
+    GENERATE_ARRAYLIST_GET(name, type)             \
+    GENERATE_ARRAYLIST_GET_FIRST(name, type)       \
+    GENERATE_ARRAYLIST_GET_LAST(name, type)        \
+    GENERATE_ARRAYLIST_AT_UNCHECKED(name, type)    \
+    GENERATE_ARRAYLIST_DATA(name, type)            \
+    GENERATE_ARRAYLIST_RUN(name, type)             \
+    GENERATE_ARRAYLIST_ITER(name, type)            \
+    GENERATE_FIXED_ARRAYLIST_MODIFY(name, type)    \
+    GENERATE_ARRAYLIST_ADD_FIRST(name, type)       \
+    GENERATE_ARRAYLIST_ADD_LAST(name, type)        \
+    GENERATE_ARRAYLIST_REMOVE_FIRST(name, type)    \
+    GENERATE_ARRAYLIST_REMOVE_LAST(name, type)
 
 /*
- * Generate `struct arraylist_<name>_t`.
+ * Generate `struct arraylist_<name>_t` for a sorted list: `data` holds the merged elements in
+ * order without duplicates, and `pending` the inserts that have not been merged yet, in the order
+ * they were made.
  */
-#define GENERATE_ARRAYLIST_STRUCT(name, type) \
-    typedef struct arraylist_##name_t {       \
-        type   *data;                         \
-        size_t  count;                        \
-        size_t  capacity;                     \
+#define GENERATE_SORTED_ARRAYLIST_STRUCT(name, type) \
+    typedef struct arraylist_##name##_t {            \
+        type               *data;                    \
+        size_t              count;                   \
+        size_t              capacity;                \
+        type               *pending;                 \
+        size_t              pending_count;           \
+        size_t              pending_capacity;        \
+        ArrayListAllocator *allocator;               \
+        ARRAYLIST_STATS_MEMBER                       \
     } ArrayList_##name;
 
 /*
- * Generates `enum arraylist_error_<name>_t`.
+ * Generates the sorted versions of `arraylist_init_with_allocator_<name>`, `arraylist_init_<name>`,
+ * `arraylist_deinit_<name>`, `arraylist_clear_<name>` and the `arraylist_create_*_<name>` family.
+ * Creating with a capacity reserves room for that many merged elements.
  */
-#define GENERATE_ARRAYLIST_ERROR_ENUM(name) \
-    typedef enum arraylist_error_##name_t { \
-        SUCCESS_##name = 0,                 \
-        EMPTY_ARRAYLIST_ERROR_##name,       \
-        INDEX_OUT_OF_BOUNDS_ERROR_##name,   \
-        MEMORY_ERROR_##name,                \
-    } ArrayListError_##name;
+#define GENERATE_SORTED_ARRAYLIST_LIFETIME(name, type)                                                      \
+    static inline void arraylist_init_with_allocator_##name(                                                \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {                                       \
+        arraylist->data             = NULL;                                                                 \
+        arraylist->count            = 0;                                                                    \
+        arraylist->capacity         = 0;                                                                    \
+        arraylist->pending          = NULL;                                                                 \
+        arraylist->pending_count    = 0;                                                                    \
+        arraylist->pending_capacity = 0;                                                                    \
+        arraylist->allocator        = allocator;                                                            \
+        ARRAYLIST_STATS_RESET(arraylist);                                                                   \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {                                 \
+        arraylist_init_with_allocator_##name(arraylist, NULL);                                              \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) {                               \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                                              \
+        arraylist_deallocate(arraylist->allocator, arraylist->data, arraylist->capacity * sizeof(type));    \
+        arraylist_deallocate(arraylist->allocator, arraylist->pending,                                      \
+                             arraylist->pending_capacity * sizeof(type));                                   \
+        arraylist_init_with_allocator_##name(arraylist, arraylist->allocator);                              \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) {                                \
+        arraylist->count         = 0;                                                                       \
+        arraylist->pending_count = 0;                                                                       \
+    }                                                                                                       \
+                                                                                                            \
+    /* Grows `*buffer`, either `data` or `pending`, to hold at least `min_capacity` elements. */            \
+    static inline ArrayListError_##name arraylist_sorted_reserve_##name(                                    \
+        ArrayList_##name *arraylist, type **buffer, size_t *capacity, size_t min_capacity) {                \
+        if (min_capacity <= *capacity) {                                                                    \
+            return SUCCESS_##name;                                                                          \
+        }                                                                                                   \
+        size_t new_capacity = arraylist_next_capacity(*capacity, min_capacity, sizeof(type),                \
+                                                      ARRAYLIST_GROWTH_1_5X);                               \
+        size_t bytes;                                                                                       \
+        if (__builtin_mul_overflow(new_capacity, sizeof(type), &bytes)) {                                   \
+            return MEMORY_ERROR_##name;                                                                     \
+        }                                                                                                   \
+        type *grown = arraylist_reallocate(arraylist->allocator, *buffer, *capacity * sizeof(type), bytes); \
+        if (grown == NULL) {                                                                                \
+            return MEMORY_ERROR_##name;                                                                     \
+        }                                                                                                   \
+        ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                                                         \
+        ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                                             \
+        *buffer   = grown;                                                                                  \
+        *capacity = new_capacity;                                                                           \
+        return SUCCESS_##name;                                                                              \
+    }                                                                                                       \
+                                                                                                            \
+    static inline ArrayList_##name *arraylist_create_with_capacity_and_allocator_##name(                    \
+        size_t capacity, ArrayListAllocator *allocator) {                                                   \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name));              \
+        if (arraylist == NULL) {                                                                            \
+            return NULL;                                                                                    \
+        }                                                                                                   \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                                         \
+        if (arraylist_sorted_reserve_##name(arraylist, &arraylist->data, &arraylist->capacity,              \
+                                            capacity) != SUCCESS_##name) {                                  \
+            arraylist_deallocate(allocator, arraylist, sizeof(ArrayList_##name));                           \
+            return NULL;                                                                                    \
+        }                                                                                                   \
+        return arraylist;                                                                                   \
+    }                                                                                                       \
+                                                                                                            \
+    static inline ArrayList_##name *arraylist_create_with_capacity_##name(size_t capacity) {                \
+        return arraylist_create_with_capacity_and_allocator_##name(capacity, NULL);                         \
+    }                                                                                                       \
+                                                                                                            \
+    static inline ArrayList_##name *arraylist_create_with_allocator_##name(                                 \
+        ArrayListAllocator *allocator) {                                                                    \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, allocator);            \
+    }                                                                                                       \
+                                                                                                            \
+    static inline ArrayList_##name *arraylist_create_##name() {                                             \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, NULL);                 \
+    }
 
 /*
- * Generates `ArrayList_<name> *arraylist_create_<name>()`.
+ * Generates the merge behind a sorted list:
+ * `ArrayListError_<name> arraylist_flush_<name>(ArrayList_<name> *arraylist)`, which merges the
+ * pending inserts into `data`, and
+ * `ArrayListError_<name> arraylist_merge_from_<name>(ArrayList_<name> *arraylist, ArrayList_<name> *src)`,
+ * which adds every element of `src` to the list. Where two elements compare equal the newer one is
+ * kept: the later of two pending inserts, and a pending insert or `src` element over a merged one.
+ * A batch of `n` pending inserts is merge sorted, using the free tail of `data` as scratch, and then
+ * merged backwards into `data` in place, so a flush costs O(n log n + count) and no extra buffer.
  */
-#define GENERATE_ARRAYLIST_CREATE(name, type)                           \
-    static inline ArrayList_##name *arraylist_create_##name() {         \
-        ArrayList_##name *arraylist = malloc(sizeof(ArrayList_##name)); \
-        if (arraylist == NULL) {                                        \
-            return NULL;                                                \
-        }                                                               \
-        arraylist->data = malloc(sizeof(type) * INITIAL_CAPACITY);      \
-        if (arraylist->data == NULL) {                                  \
-            free(arraylist);                                            \
-            return NULL;                                                \
-        }                                                               \
-        arraylist->count    = 0;                                        \
-        arraylist->capacity = INITIAL_CAPACITY;                         \
-        return arraylist;                                               \
+#define GENERATE_SORTED_ARRAYLIST_MERGE(name, type, less)                                                         \
+    /* A stable merge sort of `data`, with room for `n` elements in `scratch`. */                                 \
+    static inline void arraylist_merge_sort_##name(type *data, size_t n, type *scratch) {                         \
+        for (size_t i = 0; i < n; i += ARRAYLIST_INSERTION_SORT_THRESHOLD) {                                      \
+            size_t run = n - i < ARRAYLIST_INSERTION_SORT_THRESHOLD ? n - i : ARRAYLIST_INSERTION_SORT_THRESHOLD; \
+            arraylist_insertion_sort_##name(&data[i], run);                                                       \
+        }                                                                                                         \
+        type *src = data;                                                                                         \
+        type *dst = scratch;                                                                                      \
+        for (size_t width = ARRAYLIST_INSERTION_SORT_THRESHOLD; width < n; width *= 2) {                          \
+            for (size_t lo = 0; lo < n; lo += 2 * width) {                                                        \
+                size_t mid = n - lo < width ? n : lo + width;                                                     \
+                size_t hi  = n - mid < width ? n : mid + width;                                                   \
+                size_t i   = lo;                                                                                  \
+                size_t j   = mid;                                                                                 \
+                size_t k   = lo;                                                                                  \
+                while (i < mid && j < hi) {                                                                       \
+                    dst[k++] = less(src[j], src[i]) ? src[j++] : src[i++];                                        \
+                }                                                                                                 \
+                while (i < mid) {                                                                                 \
+                    dst[k++] = src[i++];                                                                          \
+                }                                                                                                 \
+                while (j < hi) {                                                                                  \
+                    dst[k++] = src[j++];                                                                          \
+                }                                                                                                 \
+            }                                                                                                     \
+            type *tmp = src;                                                                                      \
+            src = dst;                                                                                            \
+            dst = tmp;                                                                                            \
+        }                                                                                                         \
+        if (src != data) {                                                                                        \
+            memcpy(data, src, n * sizeof(type));                                                                  \
+        }                                                                                                         \
+    }                                                                                                             \
+                                                                                                                  \
+    /* Collapses each run of equal elements in sorted `data` to its last one, returning the new count. */         \
+    static inline size_t arraylist_sorted_unique_##name(type *data, size_t n) {                                   \
+        size_t kept = 0;                                                                                          \
+        for (size_t i = 0; i < n; i++) {                                                                          \
+            if (kept > 0 && !less(data[kept - 1], data[i])) {                                                     \
+                data[kept - 1] = data[i];                                                                         \
+            } else {                                                                                              \
+                data[kept++] = data[i];                                                                           \
+            }                                                                                                     \
+        }                                                                                                         \
+        return kept;                                                                                              \
+    }                                                                                                             \
+                                                                                                                  \
+    /* Merges `n` sorted, distinct elements that do not live in `data`, replacing equal ones. */                  \
+    static inline ArrayListError_##name arraylist_sorted_merge_##name(                                            \
+        ArrayList_##name *arraylist, const type *src, size_t n) {                                                 \
+        size_t total;                                                                                             \
+        if (__builtin_add_overflow(arraylist->count, n, &total)) {                                                \
+            return MEMORY_ERROR_##name;                                                                           \
+        }                                                                                                         \
+        ArrayListError_##name res = arraylist_sorted_reserve_##name(                                              \
+            arraylist, &arraylist->data, &arraylist->capacity, total);                                            \
+        if (res != SUCCESS_##name) {                                                                              \
+            return res;                                                                                           \
+        }                                                                                                         \
+        type *data = arraylist->data;                                                                             \
+        size_t i = arraylist->count;                                                                              \
+        size_t j = n;                                                                                             \
+        size_t k = total;                                                                                         \
+        /* `k - i` is at least `j`, so writes only land on slots that have already been read. */                  \
+        while (j > 0) {                                                                                           \
+            if (i > 0 && less(src[j - 1], data[i - 1])) {                                                         \
+                data[--k] = data[--i];                                                                            \
+            } else {                                                                                              \
+                if (i > 0 && !less(data[i - 1], src[j - 1])) {                                                    \
+                    i--;                                                                                          \
+                }                                                                                                 \
+                data[--k] = src[--j];                                                                             \
+            }                                                                                                     \
+        }                                                                                                         \
+        /* Each replaced element left a gap between data[0, i) and data[k, total). */                             \
+        if (k != i) {                                                                                             \
+            ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (total - k) * sizeof(type));                          \
+            memmove(&data[i], &data[k], (total - k) * sizeof(type));                                              \
+        }                                                                                                         \
+        arraylist->count = i + (total - k);                                                                       \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                                         \
+        return SUCCESS_##name;                                                                                    \
+    }                                                                                                             \
+                                                                                                                  \
+    static inline ArrayListError_##name arraylist_flush_##name(ArrayList_##name *arraylist) {                     \
+        size_t n = arraylist->pending_count;                                                                      \
+        if (n == 0) {                                                                                             \
+            return SUCCESS_##name;                                                                                \
+        }                                                                                                         \
+        size_t total;                                                                                             \
+        if (__builtin_add_overflow(arraylist->count, n, &total)) {                                                \
+            return MEMORY_ERROR_##name;                                                                           \
+        }                                                                                                         \
+        ArrayListError_##name res = arraylist_sorted_reserve_##name(                                              \
+            arraylist, &arraylist->data, &arraylist->capacity, total);                                            \
+        if (res != SUCCESS_##name) {                                                                              \
+            return res;                                                                                           \
+        }                                                                                                         \
+        arraylist_merge_sort_##name(arraylist->pending, n, &arraylist->data[arraylist->count]);                   \
+        n = arraylist_sorted_unique_##name(arraylist->pending, n);                                                \
+        arraylist->pending_count = 0;                                                                             \
+        return arraylist_sorted_merge_##name(arraylist, arraylist->pending, n);                                   \
+    }                                                                                                             \
+                                                                                                                  \
+    static inline ArrayListError_##name arraylist_merge_from_##name(                                              \
+        ArrayList_##name *arraylist, ArrayList_##name *src) {                                                     \
+        ArrayListError_##name res = arraylist_flush_##name(arraylist);                                            \
+        if (res != SUCCESS_##name || src == arraylist) {                                                          \
+            return res;                                                                                           \
+        }                                                                                                         \
+        res = arraylist_flush_##name(src);                                                                        \
+        if (res != SUCCESS_##name) {                                                                              \
+            return res;                                                                                           \
+        }                                                                                                         \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, src->count);                                                       \
+        return arraylist_sorted_merge_##name(arraylist, src->data, src->count);                                   \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_destroy_<name>(ArrayList_<name> *arraylist)`.
+ * Generates the sorted versions of
+ * `ArrayListError_<name> arraylist_insert_<name>(ArrayList_<name> *arraylist, type element)`,
+ * `ArrayListError_<name> arraylist_insert_range_<name>(ArrayList_<name> *arraylist, const type *src, size_t n)`,
+ * `type *arraylist_find_<name>(ArrayList_<name> *arraylist, type key)`,
+ * `bool arraylist_contains_<name>(ArrayList_<name> *arraylist, type key)` and
+ * `ArrayListError_<name> arraylist_erase_<name>(ArrayList_<name> *arraylist, type key, type *out)`.
+ * Inserts are appended to `pending` and merged in batches. `find` returns the stored element equal
+ * to `key`, or NULL, and the pointer is invalidated by the next insert, flush or erase. `erase`
+ * returns `INDEX_OUT_OF_BOUNDS_ERROR_<name>` when no element equals `key`.
  */
-#define GENERATE_ARRAYLIST_DESTROY(name)                                       \
-    static inline void arraylist_destroy_##name(ArrayList_##name *arraylist) { \
-        free(arraylist->data);                                                 \
-        free(arraylist);                                                       \
+#define GENERATE_SORTED_ARRAYLIST_INSERT_FIND(name, type, less)                                              \
+    static inline size_t arraylist_sorted_batch_##name(ArrayList_##name *arraylist) {                        \
+        size_t batch = arraylist->count / 8;                                                                 \
+        return batch > ARRAYLIST_SORTED_BATCH ? batch : ARRAYLIST_SORTED_BATCH;                              \
+    }                                                                                                        \
+                                                                                                             \
+    static inline ArrayListError_##name arraylist_insert_range_##name(                                       \
+        ArrayList_##name *arraylist, const type *src, size_t n) {                                            \
+        size_t total;                                                                                        \
+        if (__builtin_add_overflow(arraylist->pending_count, n, &total)) {                                   \
+            return MEMORY_ERROR_##name;                                                                      \
+        }                                                                                                    \
+        ArrayListError_##name res = arraylist_sorted_reserve_##name(                                         \
+            arraylist, &arraylist->pending, &arraylist->pending_capacity, total);                            \
+        if (res != SUCCESS_##name) {                                                                         \
+            return res;                                                                                      \
+        }                                                                                                    \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, n);                                                           \
+        memcpy(&arraylist->pending[arraylist->pending_count], src, n * sizeof(type));                        \
+        arraylist->pending_count = total;                                                                    \
+        if (total >= arraylist_sorted_batch_##name(arraylist)) {                                             \
+            return arraylist_flush_##name(arraylist);                                                        \
+        }                                                                                                    \
+        return SUCCESS_##name;                                                                               \
+    }                                                                                                        \
+                                                                                                             \
+    static inline ArrayListError_##name arraylist_insert_##name(ArrayList_##name *arraylist, type element) { \
+        return arraylist_insert_range_##name(arraylist, &element, 1);                                        \
+    }                                                                                                        \
+                                                                                                             \
+    static inline type *arraylist_find_##name(ArrayList_##name *arraylist, type key) {                       \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                                           \
+        /* If the merge fails the pending inserts are still searched, only more slowly. */                   \
+        if (arraylist->pending_count > ARRAYLIST_SORTED_SCAN) {                                              \
+            (void)arraylist_flush_##name(arraylist);                                                         \
+        }                                                                                                    \
+        for (size_t i = arraylist->pending_count; i > 0; i--) {                                              \
+            if (!less(arraylist->pending[i - 1], key) && !less(key, arraylist->pending[i - 1])) {            \
+                return &arraylist->pending[i - 1];                                                           \
+            }                                                                                                \
+        }                                                                                                    \
+        size_t index = arraylist_binary_search_##name(arraylist, key);                                       \
+        return index == ARRAYLIST_NOT_FOUND ? NULL : &arraylist->data[index];                                \
+    }                                                                                                        \
+                                                                                                             \
+    static inline bool arraylist_contains_##name(ArrayList_##name *arraylist, type key) {                    \
+        return arraylist_find_##name(arraylist, key) != NULL;                                                \
+    }                                                                                                        \
+                                                                                                             \
+    static inline ArrayListError_##name arraylist_erase_##name(                                              \
+        ArrayList_##name *arraylist, type key, type *out) {                                                  \
+        ArrayListError_##name res = arraylist_flush_##name(arraylist);                                       \
+        if (res != SUCCESS_##name) {                                                                         \
+            return res;                                                                                      \
+        }                                                                                                    \
+        if (arraylist->count == 0) {                                                                         \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                             \
+        }                                                                                                    \
+        size_t index = arraylist_binary_search_##name(arraylist, key);                                       \
+        if (index == ARRAYLIST_NOT_FOUND) {                                                                  \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                         \
+        }                                                                                                    \
+        if (out != NULL) {                                                                                   \
+            *out = arraylist->data[index];                                                                   \
+        }                                                                                                    \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                        \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, (arraylist->count - index - 1) * sizeof(type));      \
+        memmove(&arraylist->data[index], &arraylist->data[index + 1],                                        \
+                (arraylist->count - index - 1) * sizeof(type));                                              \
+        arraylist->count -= 1;                                                                               \
+        return SUCCESS_##name;                                                                               \
     }
 
 /*
- * Generates `size_t arraylist_count_<name>(ArrayList_<name> *arraylist)`.
+ * Generates a sorted set suffixed by `name` for a given `type`, ordered by `less(a, b)` and holding
+ * no two elements that compare equal. With a `type` that pairs a key and a value and a `less` that
+ * compares only keys, it is a flat map whose inserts replace the value stored under the same key.
+ * Inserts are buffered and merged in sorted batches, so building a set of n elements costs
+ * O(n log n) instead of the O(n^2) of keeping the array sorted after every insert. Reads through
+ * count, get, data, iterators and the lower/upper bound and binary searches only see merged elements;
+ * call `arraylist_flush_<name>` after inserting to include the rest. `find`, `contains`, `erase`
+ * and `merge_from` see everything. Elements are copied with `memcpy`/`memmove`, so `type` must
+ * need no element hooks.
  */
-#define GENERATE_ARRAYLIST_COUNT(name)                                         \
-    static inline size_t arraylist_count_##name(ArrayList_##name *arraylist) { \
-        return arraylist->count;                                               \
+#define GENERATE_SORTED_ARRAYLIST(name, type, less)   \
+    GENERATE_SORTED_ARRAYLIST_STRUCT(name, type)      \
+    GENERATE_ARRAYLIST_STATS(name)                    \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)               \
+    GENERATE_SORTED_ARRAYLIST_LIFETIME(name, type)    \
+    GENERATE_ARRAYLIST_DESTROY(name, type)            \
+    GENERATE_ARRAYLIST_COUNT(name)                    \
+    GENERATE_ARRAYLIST_CAPACITY(name)                 \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)                 \
+    GENERATE_ARRAYLIST_GET(name, type)                \
+    GENERATE_ARRAYLIST_GET_FIRST(name, type)          \
+    GENERATE_ARRAYLIST_GET_LAST(name, type)           \
+    GENERATE_ARRAYLIST_AT_UNCHECKED(name, type)       \
+    GENERATE_ARRAYLIST_DATA(name, type)               \
+    GENERATE_ARRAYLIST_RUN(name, type)                \
+    GENERATE_ARRAYLIST_ITER(name, type)               \
+    GENERATE_ARRAYLIST_SORT_RANGE(name, type, less)   \
+    GENERATE_ARRAYLIST_SORT_SEARCH(name, type, less)  \
+    GENERATE_SORTED_ARRAYLIST_MERGE(name, type, less) \
+    GENERATE_SORTED_ARRAYLIST_INSERT_FIND(name, type, less)
+
+/*
+ * Generate `struct arraylist_<name>_t` for a ring buffer: the logical element `i`
+ * lives at physical slot `(head + i) % capacity`.
+ */
+#define GENERATE_ARRAYLIST_DEQUE_STRUCT(name, type) \
+    typedef struct arraylist_##name##_t {           \
+        type                 *data;                 \
+        size_t                head;                 \
+        size_t                count;                \
+        size_t                capacity;             \
+        ArrayListAllocator   *allocator;            \
+        ArrayListGrowthPolicy growth_policy;        \
+        ArrayListStorage      storage;              \
+        ARRAYLIST_STATS_MEMBER                      \
+    } ArrayList_##name;
+
+/*
+ * Generates `size_t arraylist_slot_<name>(ArrayList_<name> *arraylist, size_t index)`,
+ * the physical slot of logical `index` (which must be less than the capacity).
+ */
+#define GENERATE_ARRAYLIST_DEQUE_SLOT(name)                                                 \
+    static inline size_t arraylist_slot_##name(ArrayList_##name *arraylist, size_t index) { \
+        size_t slot = arraylist->head + index;                                              \
+        if (slot >= arraylist->capacity) {                                                  \
+            slot -= arraylist->capacity;                                                    \
+        }                                                                                   \
+        return slot;                                                                        \
     }
 
 /*
- * Generates `bool arraylist_is_empty_<name>(ArrayList_<name> *arraylist)`.
+ * Generates the ring buffer version of `arraylist_run_<name>`, whose runs stop where the buffer wraps.
  */
-#define GENERATE_ARRAYLIST_IS_EMPTY(name)                                       \
-    static inline bool arraylist_is_empty_##name(ArrayList_##name *arraylist) { \
-        return arraylist->count == 0;                                           \
+#define GENERATE_ARRAYLIST_DEQUE_RUN(name, type)                                                       \
+    static inline size_t arraylist_run_##name(ArrayList_##name *arraylist, size_t index, type **ptr) { \
+        if (index >= arraylist->count) {                                                               \
+            return 0;                                                                                  \
+        }                                                                                              \
+        size_t slot = arraylist_slot_##name(arraylist, index);                                         \
+        size_t n    = arraylist->count - index;                                                        \
+        *ptr = &arraylist->data[slot];                                                                 \
+        return n < arraylist->capacity - slot ? n : arraylist->capacity - slot;                        \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_get_<name>(ArrayList_<name> *arraylist, size_t index, type *out)`.
+ * Generates the deque versions of `arraylist_init_with_allocator_<name>`, `arraylist_init_<name>`,
+ * `arraylist_deinit_<name>` and `arraylist_clear_<name>`.
  */
-#define GENERATE_ARRAYLIST_GET(name, type)                      \
-    static inline ArrayListError_##name arraylist_get_##name(   \
-        ArrayList_##name *arraylist, size_t index, type *out) { \
-        if (arraylist->count == 0) {                            \
-            return EMPTY_ARRAYLIST_ERROR_##name;                \
-        }                                                       \
-        if (index >= arraylist->count) {                        \
-            return INDEX_OUT_OF_BOUNDS_ERROR_##name;            \
-        }                                                       \
-        if (out != NULL) {                                      \
-            *out = arraylist->data[index];                      \
-        }                                                       \
-        return SUCCESS_##name;                                  \
+#define GENERATE_ARRAYLIST_DEQUE_INIT(name, type)                             \
+    static inline void arraylist_init_with_allocator_##name(                  \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {         \
+        arraylist->data          = NULL;                                      \
+        arraylist->head          = 0;                                         \
+        arraylist->count         = 0;                                         \
+        arraylist->capacity      = 0;                                         \
+        arraylist->allocator     = allocator;                                 \
+        arraylist->growth_policy = ARRAYLIST_GROWTH_1_5X;                     \
+        arraylist->storage       = ARRAYLIST_STORAGE_HEAP;                    \
+        ARRAYLIST_STATS_RESET(arraylist);                                     \
+    }                                                                         \
+                                                                              \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {   \
+        arraylist_init_with_allocator_##name(arraylist, NULL);                \
+    }                                                                         \
+                                                                              \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) { \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                \
+        ARRAYLIST_STATS_RESET(arraylist);                                     \
+        arraylist_free_data_##name(arraylist);                                \
+        arraylist->data     = NULL;                                           \
+        arraylist->head     = 0;                                              \
+        arraylist->count    = 0;                                              \
+        arraylist->capacity = 0;                                              \
+    }                                                                         \
+                                                                              \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) {  \
+        arraylist->head  = 0;                                                 \
+        arraylist->count = 0;                                                 \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_set_<name>(ArrayList_<name> *arraylist, size_t index, type new_element, type *out)`.
+ * Generates the deque versions of `arraylist_get_<name>`, `arraylist_set_<name>`,
+ * `arraylist_get_first_<name>`, `arraylist_get_last_<name>` and `arraylist_at_unchecked_<name>`.
  */
-#define GENERATE_ARRAYLIST_SET(name, type)                                        \
+#define GENERATE_ARRAYLIST_DEQUE_ACCESS(name, type)                               \
+    static inline ArrayListError_##name arraylist_get_##name(                     \
+        ArrayList_##name *arraylist, size_t index, type *out) {                   \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                \
+        if (arraylist->count == 0) {                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                  \
+        }                                                                         \
+        if (index >= arraylist->count) {                                          \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                              \
+        }                                                                         \
+        if (out != NULL) {                                                        \
+            *out = arraylist->data[arraylist_slot_##name(arraylist, index)];      \
+        }                                                                         \
+        return SUCCESS_##name;                                                    \
+    }                                                                             \
+                                                                                  \
     static inline ArrayListError_##name arraylist_set_##name(                     \
         ArrayList_##name *arraylist, size_t index, type new_element, type *out) { \
         if (arraylist->count == 0) {                                              \
@@ -112,180 +4157,1295 @@
         if (index >= arraylist->count) {                                          \
             return INDEX_OUT_OF_BOUNDS_ERROR_##name;                              \
         }                                                                         \
+        size_t slot = arraylist_slot_##name(arraylist, index);                    \
         if (out != NULL) {                                                        \
-            *out = arraylist->data[index];                                        \
+            *out = arraylist->data[slot];                                         \
         }                                                                         \
-        arraylist->data[index] = new_element;                                     \
+        arraylist->data[slot] = new_element;                                      \
         return SUCCESS_##name;                                                    \
+    }                                                                             \
+                                                                                  \
+    static inline ArrayListError_##name arraylist_get_first_##name(               \
+        ArrayList_##name *arraylist, type *out) {                                 \
+        return arraylist_get_##name(arraylist, 0, out);                           \
+    }                                                                             \
+                                                                                  \
+    static inline ArrayListError_##name arraylist_get_last_##name(                \
+        ArrayList_##name *arraylist, type *out) {                                 \
+        if (arraylist->count == 0) {                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                  \
+        }                                                                         \
+        return arraylist_get_##name(arraylist, arraylist->count - 1, out);        \
+    }                                                                             \
+                                                                                  \
+    static inline type arraylist_at_unchecked_##name(                             \
+        ArrayList_##name *arraylist, size_t index) {                              \
+        ARRAYLIST_DEBUG_ASSERT(index < arraylist->count);                         \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                \
+        return arraylist->data[arraylist_slot_##name(arraylist, index)];          \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_get_first_<name>(ArrayList_<name> *arraylist, type *out)`.
+ * Generates the deque version of `arraylist_grow_<name>`.
+ * If the elements wrap around, the part before the end of the old buffer moves to the end of the new one.
  */
-#define GENERATE_ARRAYLIST_GET_FIRST(name, type)                    \
-    static inline ArrayListError_##name arraylist_get_first_##name( \
-        ArrayList_##name *arraylist, type *out) {                   \
-        if (arraylist->count == 0) {                                \
-            return EMPTY_ARRAYLIST_ERROR_##name;                    \
-        }                                                           \
-        if (out != NULL) {                                          \
-            *out = arraylist->data[0];                              \
-        }                                                           \
-        return SUCCESS_##name;                                      \
+#define GENERATE_ARRAYLIST_DEQUE_GROW(name, type)                                             \
+    static inline ArrayListError_##name arraylist_grow_##name(                                \
+        ArrayList_##name *arraylist, size_t new_capacity) {                                   \
+        assert(new_capacity > arraylist->capacity);                                           \
+        size_t bytes;                                                                         \
+        if (__builtin_mul_overflow(new_capacity, sizeof(type), &bytes)) {                     \
+            return MEMORY_ERROR_##name;                                                       \
+        }                                                                                     \
+        size_t old_capacity = arraylist->capacity;                                            \
+        type *new_array = arraylist_reallocate(arraylist->allocator,                          \
+            arraylist->data, old_capacity * sizeof(type), bytes);                             \
+        if (new_array == NULL) {                                                              \
+            return MEMORY_ERROR_##name;                                                       \
+        }                                                                                     \
+        ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                                           \
+        ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                               \
+        if (arraylist->head + arraylist->count > old_capacity) {                              \
+            size_t front = old_capacity - arraylist->head;                                    \
+            size_t new_head = new_capacity - front;                                           \
+            memmove(&new_array[new_head], &new_array[arraylist->head], front * sizeof(type)); \
+            arraylist->head = new_head;                                                       \
+            ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes, front * sizeof(type));            \
+        }                                                                                     \
+        arraylist->data     = new_array;                                                      \
+        arraylist->capacity = new_capacity;                                                   \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                     \
+        return SUCCESS_##name;                                                                \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_get_last_<name>(ArrayList_<name> *arraylist, type *out)`.
+ * Generates the deque versions of `arraylist_add_<name>` and `arraylist_remove_<name>`.
+ * Whichever side of `index` is shorter is shifted, so adding or removing at either end is O(1).
  */
-#define GENERATE_ARRAYLIST_GET_LAST(name, type)                    \
-    static inline ArrayListError_##name arraylist_get_last_##name( \
-        ArrayList_##name *arraylist, type *out) {                  \
-        if (arraylist->count == 0) {                               \
-            return EMPTY_ARRAYLIST_ERROR_##name;                   \
-        }                                                          \
-        if (out != NULL) {                                         \
-            *out = arraylist->data[arraylist->count - 1];          \
-        }                                                          \
-        return SUCCESS_##name;                                     \
+#define GENERATE_ARRAYLIST_DEQUE_ADD_REMOVE(name, type)                                             \
+    static inline ArrayListError_##name arraylist_add_##name(                                       \
+        ArrayList_##name *arraylist, size_t index, type element) {                                  \
+        if (index > arraylist->count) {                                                             \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                \
+        }                                                                                           \
+        if (arraylist->count == arraylist->capacity) {                                              \
+            if (arraylist->capacity == SIZE_MAX) {                                                  \
+                return MEMORY_ERROR_##name;                                                         \
+            }                                                                                       \
+            ArrayListError_##name res = arraylist_ensure_capacity_##name(                           \
+                arraylist, arraylist->capacity + 1);                                                \
+            if (res != SUCCESS_##name) {                                                            \
+                return res;                                                                         \
+            }                                                                                       \
+        }                                                                                           \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                  \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes,                                             \
+            (index < arraylist->count / 2 ? index : arraylist->count - index) * sizeof(type));      \
+        if (index < arraylist->count / 2) {                                                         \
+            arraylist->head = arraylist->head == 0 ? arraylist->capacity - 1 : arraylist->head - 1; \
+            for (size_t i = 0; i < index; i++) {                                                    \
+                arraylist->data[arraylist_slot_##name(arraylist, i)] =                              \
+                    arraylist->data[arraylist_slot_##name(arraylist, i + 1)];                       \
+            }                                                                                       \
+        } else {                                                                                    \
+            for (size_t i = arraylist->count; i > index; i--) {                                     \
+                arraylist->data[arraylist_slot_##name(arraylist, i)] =                              \
+                    arraylist->data[arraylist_slot_##name(arraylist, i - 1)];                       \
+            }                                                                                       \
+        }                                                                                           \
+        arraylist->data[arraylist_slot_##name(arraylist, index)] = element;                         \
+        arraylist->count += 1;                                                                      \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                           \
+        return SUCCESS_##name;                                                                      \
+    }                                                                                               \
+                                                                                                    \
+    static inline ArrayListError_##name arraylist_remove_##name(                                    \
+        ArrayList_##name *arraylist, size_t index, type *out) {                                     \
+        if (arraylist->count == 0) {                                                                \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                    \
+        }                                                                                           \
+        if (index >= arraylist->count) {                                                            \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                \
+        }                                                                                           \
+        if (out != NULL) {                                                                          \
+            *out = arraylist->data[arraylist_slot_##name(arraylist, index)];                        \
+        }                                                                                           \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, memmove_bytes,                                             \
+            (index < arraylist->count / 2 ? index : arraylist->count - index - 1) * sizeof(type));  \
+        if (index < arraylist->count / 2) {                                                         \
+            for (size_t i = index; i > 0; i--) {                                                    \
+                arraylist->data[arraylist_slot_##name(arraylist, i)] =                              \
+                    arraylist->data[arraylist_slot_##name(arraylist, i - 1)];                       \
+            }                                                                                       \
+            arraylist->head = arraylist_slot_##name(arraylist, 1);                                  \
+        } else {                                                                                    \
+            for (size_t i = index; i + 1 < arraylist->count; i++) {                                 \
+                arraylist->data[arraylist_slot_##name(arraylist, i)] =                              \
+                    arraylist->data[arraylist_slot_##name(arraylist, i + 1)];                       \
+            }                                                                                       \
+        }                                                                                           \
+        arraylist->count -= 1;                                                                      \
+        if (arraylist->count == 0) {                                                                \
+            arraylist->head = 0;                                                                    \
+        }                                                                                           \
+        return SUCCESS_##name;                                                                      \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_grow_<name>(ArrayList_<name> *arraylist, size_t new_capacity)`.
+ * Generates an ArrayList suffixed by `name` for a given `type`, stored as a ring buffer so that
+ * adding and removing at the front is amortized O(1) like at the back.
+ * It provides create/destroy/init/deinit, count/capacity/is_empty, get/set/get_first/get_last,
+ * at_unchecked, reserve, clear, set_growth_policy, add/add_first/add_last and
+ * remove/remove_first/remove_last; the elements are not contiguous, so the rest of the
+ * `GENERATE_ARRAYLIST` API is not available.
+ */
+#define GENERATE_ARRAYLIST_DEQUE(name, type)        \
+    GENERATE_ARRAYLIST_DEQUE_STRUCT(name, type)     \
+    GENERATE_ARRAYLIST_STATS(name)                  \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)             \
+    GENERATE_ARRAYLIST_DEQUE_SLOT(name)             \
+    GENERATE_ARRAYLIST_DEQUE_RUN(name, type)        \
+    GENERATE_ARRAYLIST_ITER(name, type)             \
+    GENERATE_ARRAYLIST_FREE_DATA(name, type)        \
+    GENERATE_ARRAYLIST_DEQUE_INIT(name, type)       \
+    GENERATE_ARRAYLIST_CREATE(name, type)           \
+    GENERATE_ARRAYLIST_DESTROY(name, type)          \
+    GENERATE_ARRAYLIST_COUNT(name)                  \
+    GENERATE_ARRAYLIST_CAPACITY(name)               \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)               \
+    GENERATE_ARRAYLIST_DEQUE_ACCESS(name, type)     \
+    GENERATE_ARRAYLIST_DEQUE_GROW(name, type)       \
+    GENERATE_ARRAYLIST_ENSURE_CAPACITY(name, type)  \
+    GENERATE_ARRAYLIST_RESERVE(name, type)          \
+    GENERATE_ARRAYLIST_SET_GROWTH_POLICY(name)      \
+    GENERATE_ARRAYLIST_DEQUE_ADD_REMOVE(name, type) \
+    GENERATE_ARRAYLIST_ADD_FIRST(name, type)        \
+    GENERATE_ARRAYLIST_ADD_LAST(name, type)         \
+    GENERATE_ARRAYLIST_REMOVE_FIRST(name, type)     \
+    GENERATE_ARRAYLIST_REMOVE_LAST(name, type)
+
+/*
+ * Generate `struct arraylist_<name>_t` for a list that many threads append to at once.
+ * `reserved` counts claimed slots and `count` the published prefix; they are kept on
+ * separate cache lines so readers polling `count` don't slow down producers claiming slots.
  */
-#define GENERATE_ARRAYLIST_GROW(name, type)                               \
-    static inline ArrayListError_##name arraylist_grow_##name(            \
-        ArrayList_##name *arraylist, size_t new_capacity) {               \
-        assert(new_capacity > arraylist->capacity);                       \
-        size_t bytes;                                                     \
-        if (__builtin_mul_overflow(new_capacity, sizeof(type), &bytes)) { \
-            return MEMORY_ERROR_##name;                                   \
-        }                                                                 \
-        type *new_array = realloc(arraylist->data, bytes);                \
-        if (new_array == NULL) {                                          \
-            return MEMORY_ERROR_##name;                                   \
-        }                                                                 \
-        arraylist->data     = new_array;                                  \
-        arraylist->capacity = new_capacity;                               \
-        return SUCCESS_##name;                                            \
+#define GENERATE_CONCURRENT_ARRAYLIST_STRUCT(name, type)           \
+    typedef struct arraylist_##name##_t {                          \
+        type               *segments[ARRAYLIST_MAX_SEGMENTS];      \
+        ArrayListAllocator *allocator;                             \
+        size_t              reserved __attribute__((aligned(64))); \
+        size_t              count __attribute__((aligned(64)));    \
+    } ArrayList_##name;
+
+/*
+ * Generates the concurrent versions of `arraylist_init_with_allocator_<name>`, `arraylist_init_<name>`,
+ * `arraylist_deinit_<name>`, `arraylist_create_with_allocator_<name>`, `arraylist_create_<name>`
+ * and `arraylist_destroy_<name>`. None of them may run concurrently with other calls on the same list.
+ */
+#define GENERATE_CONCURRENT_ARRAYLIST_LIFETIME(name, type)                                     \
+    static inline void arraylist_init_with_allocator_##name(                                   \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {                          \
+        for (size_t i = 0; i < ARRAYLIST_MAX_SEGMENTS; i++) {                                  \
+            arraylist->segments[i] = NULL;                                                     \
+        }                                                                                      \
+        arraylist->allocator = allocator;                                                      \
+        arraylist->reserved  = 0;                                                              \
+        arraylist->count     = 0;                                                              \
+    }                                                                                          \
+                                                                                               \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {                    \
+        arraylist_init_with_allocator_##name(arraylist, NULL);                                 \
+    }                                                                                          \
+                                                                                               \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) {                  \
+        for (size_t i = 0; i < ARRAYLIST_MAX_SEGMENTS; i++) {                                  \
+            arraylist_deallocate(arraylist->allocator, arraylist->segments[i],                 \
+                                 arraylist_segment_size(i) * sizeof(type));                    \
+            arraylist->segments[i] = NULL;                                                     \
+        }                                                                                      \
+        arraylist->reserved = 0;                                                               \
+        arraylist->count    = 0;                                                               \
+    }                                                                                          \
+                                                                                               \
+    static inline ArrayList_##name *arraylist_create_with_allocator_##name(                    \
+        ArrayListAllocator *allocator) {                                                       \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name)); \
+        if (arraylist == NULL) {                                                               \
+            return NULL;                                                                       \
+        }                                                                                      \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                            \
+        return arraylist;                                                                      \
+    }                                                                                          \
+                                                                                               \
+    static inline ArrayList_##name *arraylist_create_##name() {                                \
+        return arraylist_create_with_allocator_##name(NULL);                                   \
+    }                                                                                          \
+                                                                                               \
+    static inline void arraylist_destroy_##name(ArrayList_##name *arraylist) {                 \
+        arraylist_deinit_##name(arraylist);                                                    \
+        arraylist_deallocate(arraylist->allocator, arraylist, sizeof(ArrayList_##name));       \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_add_<name>(ArrayList_<name> *arraylist, size_t index, type element)`.
+ * Generates the concurrent versions of `arraylist_count_<name>` and `arraylist_is_empty_<name>`,
+ * which only see published elements.
  */
-#define GENERATE_ARRAYLIST_ADD(name, type)                                                                            \
-    static inline ArrayListError_##name arraylist_add_##name(                                                         \
-        ArrayList_##name *arraylist, size_t index, type element) {                                                    \
-        if (index > arraylist->count) {                                                                               \
-            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                                  \
-        }                                                                                                             \
-        if (arraylist->count == arraylist->capacity) {                                                                \
-            size_t cap = arraylist->capacity;                                                                         \
-            size_t half_of_cap = cap >> 1;                                                                            \
-            size_t new_capacity;                                                                                      \
-            /* There's a case where `new_capacity == arraylist->capacity` when `arraylist->capacity < 2`, */          \
-            /* as `half_of_cap` will be 0, and therefore `new_capacity = cap + half_of_cap = arraylist->capacity`. */ \
-            /* However, the initial capacity is always 10, so this case will never happen. */                         \
-            if (__builtin_add_overflow(arraylist->capacity, half_of_cap, &new_capacity)) {                            \
-                if (cap == SIZE_MAX) {                                                                                \
-                    return MEMORY_ERROR_##name;                                                                       \
-                }                                                                                                     \
-                /* guarantee progress */                                                                              \
-                new_capacity = cap + 1;                                                                               \
-            }                                                                                                         \
-            ArrayListError_##name res = arraylist_grow_##name(                                                        \
-                arraylist, new_capacity);                                                                             \
-            if (res != SUCCESS_##name) {                                                                              \
-                return res;                                                                                           \
-            }                                                                                                         \
-        }                                                                                                             \
-        memmove(&arraylist->data[index + 1], &arraylist->data[index],                                                 \
-                (arraylist->count - index) * sizeof(type));                                                           \
-        arraylist->data[index] = element;                                                                             \
-        arraylist->count += 1;                                                                                        \
-        return SUCCESS_##name;                                                                                        \
+#define GENERATE_CONCURRENT_ARRAYLIST_COUNT(name)                               \
+    static inline size_t arraylist_count_##name(ArrayList_##name *arraylist) {  \
+        return __atomic_load_n(&arraylist->count, __ATOMIC_ACQUIRE);            \
+    }                                                                           \
+                                                                                \
+    static inline bool arraylist_is_empty_##name(ArrayList_##name *arraylist) { \
+        return arraylist_count_##name(arraylist) == 0;                          \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_add_first_<name>(ArrayList_<name> *arraylist, type element)`.
+ * Generates the concurrent versions of `arraylist_get_<name>`, `arraylist_get_first_<name>`,
+ * `arraylist_get_last_<name>` and `arraylist_run_<name>`. They are safe to call while other
+ * threads append, and only see the published prefix.
  */
-#define GENERATE_ARRAYLIST_ADD_FIRST(name, type)                    \
-    static inline ArrayListError_##name arraylist_add_first_##name( \
-        ArrayList_##name *arraylist, type element) {                \
-        return arraylist_add_##name(arraylist, 0, element);         \
+#define GENERATE_CONCURRENT_ARRAYLIST_GET(name, type)                                        \
+    static inline ArrayListError_##name arraylist_get_##name(                                \
+        ArrayList_##name *arraylist, size_t index, type *out) {                              \
+        size_t count = arraylist_count_##name(arraylist);                                    \
+        if (count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                             \
+        }                                                                                    \
+        if (index >= count) {                                                                \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                         \
+        }                                                                                    \
+        if (out != NULL) {                                                                   \
+            size_t offset;                                                                   \
+            size_t segment = arraylist_segment_of(index, &offset);                           \
+            *out = __atomic_load_n(&arraylist->segments[segment], __ATOMIC_RELAXED)[offset]; \
+        }                                                                                    \
+        return SUCCESS_##name;                                                               \
+    }                                                                                        \
+                                                                                             \
+    static inline ArrayListError_##name arraylist_get_first_##name(                          \
+        ArrayList_##name *arraylist, type *out) {                                            \
+        return arraylist_get_##name(arraylist, 0, out);                                      \
+    }                                                                                        \
+                                                                                             \
+    static inline ArrayListError_##name arraylist_get_last_##name(                           \
+        ArrayList_##name *arraylist, type *out) {                                            \
+        size_t count = arraylist_count_##name(arraylist);                                    \
+        if (count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                             \
+        }                                                                                    \
+        return arraylist_get_##name(arraylist, count - 1, out);                              \
+    }                                                                                        \
+                                                                                             \
+    static inline size_t arraylist_run_##name(                                               \
+        ArrayList_##name *arraylist, size_t index, type **ptr) {                             \
+        size_t count = arraylist_count_##name(arraylist);                                    \
+        if (index >= count) {                                                                \
+            return 0;                                                                        \
+        }                                                                                    \
+        size_t offset;                                                                       \
+        size_t segment = arraylist_segment_of(index, &offset);                               \
+        size_t left    = arraylist_segment_size(segment) - offset;                           \
+        *ptr = &__atomic_load_n(&arraylist->segments[segment], __ATOMIC_RELAXED)[offset];    \
+        return count - index < left ? count - index : left;                                  \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_add_last_<name>(ArrayList_<name> *arraylist, type element)`.
+ * Generates the concurrent version of `arraylist_add_last_<name>`, safe to call from many threads.
+ * A slot is claimed with a CAS on `reserved` once its segment exists, so a failed segment
+ * allocation returns `MEMORY_ERROR_<name>` without leaving a hole. The element is then published
+ * in index order: each producer waits for the producers before it, so readers always see a
+ * gap-free prefix. Segments never move, so published elements stay where they are.
  */
-#define GENERATE_ARRAYLIST_ADD_LAST(name, type)                            \
-    static inline ArrayListError_##name arraylist_add_last_##name(         \
-        ArrayList_##name *arraylist, type element) {                       \
-        return arraylist_add_##name(arraylist, arraylist->count, element); \
+#define GENERATE_CONCURRENT_ARRAYLIST_ADD_LAST(name, type)                                     \
+    static inline ArrayListError_##name arraylist_add_last_##name(                             \
+        ArrayList_##name *arraylist, type element) {                                           \
+        size_t index = __atomic_load_n(&arraylist->reserved, __ATOMIC_RELAXED);                \
+        size_t offset;                                                                         \
+        size_t segment;                                                                        \
+        type  *slots;                                                                          \
+        do {                                                                                   \
+            if (index == SIZE_MAX) {                                                           \
+                return MEMORY_ERROR_##name;                                                    \
+            }                                                                                  \
+            segment = arraylist_segment_of(index, &offset);                                    \
+            slots = __atomic_load_n(&arraylist->segments[segment], __ATOMIC_ACQUIRE);          \
+            if (slots == NULL) {                                                               \
+                size_t bytes = arraylist_segment_size(segment) * sizeof(type);                 \
+                type *fresh = arraylist_allocate(arraylist->allocator, bytes);                 \
+                if (fresh == NULL) {                                                           \
+                    return MEMORY_ERROR_##name;                                                \
+                }                                                                              \
+                if (!__atomic_compare_exchange_n(&arraylist->segments[segment], &slots, fresh, \
+                                                 false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) { \
+                    arraylist_deallocate(arraylist->allocator, fresh, bytes);                  \
+                } else {                                                                       \
+                    slots = fresh;                                                             \
+                }                                                                              \
+            }                                                                                  \
+        } while (!__atomic_compare_exchange_n(&arraylist->reserved, &index, index + 1,         \
+                                              true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));      \
+        slots[offset] = element;                                                               \
+        for (unsigned spins = 0;                                                               \
+             __atomic_load_n(&arraylist->count, __ATOMIC_ACQUIRE) != index; spins++) {         \
+            if (spins < ARRAYLIST_SPINS_BEFORE_YIELD) {                                        \
+                ARRAYLIST_CPU_RELAX();                                                         \
+            } else {                                                                           \
+                ARRAYLIST_YIELD();                                                             \
+            }                                                                                  \
+        }                                                                                      \
+        __atomic_store_n(&arraylist->count, index + 1, __ATOMIC_RELEASE);                      \
+        return SUCCESS_##name;                                                                 \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_remove_first_<name>(ArrayList_<name> *arraylist, type *out)`.
+ * Generates an ArrayList suffixed by `name` for a given `type` that many threads can append to
+ * at once, while other threads read the published elements.
+ * It provides create/destroy/init/deinit, count/is_empty, get/get_first/get_last and add_last.
+ * Elements are stored in segments that never move, so there is no capacity or growth policy.
  */
-#define GENERATE_ARRAYLIST_REMOVE_FIRST(name, type)                    \
-    static inline ArrayListError_##name arraylist_remove_first_##name( \
-        ArrayList_##name *arraylist, type *out) {                      \
-        return arraylist_remove_##name(arraylist, 0, out);             \
+#define GENERATE_CONCURRENT_ARRAYLIST(name, type)      \
+    GENERATE_CONCURRENT_ARRAYLIST_STRUCT(name, type)   \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)                \
+    GENERATE_CONCURRENT_ARRAYLIST_LIFETIME(name, type) \
+    GENERATE_CONCURRENT_ARRAYLIST_COUNT(name)          \
+    GENERATE_CONCURRENT_ARRAYLIST_GET(name, type)      \
+    GENERATE_ARRAYLIST_ITER(name, type)                \
+    GENERATE_CONCURRENT_ARRAYLIST_ADD_LAST(name, type)
+
+/*
+ * Generate `struct arraylist_<name>_t` for a list stored in segments that never move.
+ * Segments are allocated in order, so the first `capacity` slots always exist.
+ */
+#define GENERATE_SEGMENTED_ARRAYLIST_STRUCT(name, type)       \
+    typedef struct arraylist_##name##_t {                     \
+        type               *segments[ARRAYLIST_MAX_SEGMENTS]; \
+        size_t              count;                            \
+        size_t              capacity;                         \
+        ArrayListAllocator *allocator;                        \
+        ARRAYLIST_STATS_MEMBER                                \
+    } ArrayList_##name;
+
+/*
+ * Generates the segmented versions of `arraylist_init_with_allocator_<name>`, `arraylist_init_<name>`,
+ * `arraylist_deinit_<name>`, `arraylist_grow_<name>` and the `arraylist_create_*_<name>` family.
+ * Growing allocates whole segments up to `new_capacity` and never copies elements, so a failed
+ * allocation leaves the list as it was.
+ */
+#define GENERATE_SEGMENTED_ARRAYLIST_LIFETIME(name, type)                                        \
+    static inline void arraylist_init_with_allocator_##name(                                     \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {                            \
+        for (size_t i = 0; i < ARRAYLIST_MAX_SEGMENTS; i++) {                                    \
+            arraylist->segments[i] = NULL;                                                       \
+        }                                                                                        \
+        arraylist->count     = 0;                                                                \
+        arraylist->capacity  = 0;                                                                \
+        arraylist->allocator = allocator;                                                        \
+        ARRAYLIST_STATS_RESET(arraylist);                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {                      \
+        arraylist_init_with_allocator_##name(arraylist, NULL);                                   \
+    }                                                                                            \
+                                                                                                 \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) {                    \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                                   \
+        ARRAYLIST_STATS_RESET(arraylist);                                                        \
+        for (size_t i = 0; i < ARRAYLIST_MAX_SEGMENTS && arraylist->segments[i] != NULL; i++) {  \
+            arraylist_deallocate(arraylist->allocator, arraylist->segments[i],                   \
+                                 arraylist_segment_size(i) * sizeof(type));                      \
+            arraylist->segments[i] = NULL;                                                       \
+        }                                                                                        \
+        arraylist->count    = 0;                                                                 \
+        arraylist->capacity = 0;                                                                 \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayListError_##name arraylist_grow_##name(                                   \
+        ArrayList_##name *arraylist, size_t new_capacity) {                                      \
+        size_t offset;                                                                           \
+        size_t segment = arraylist->capacity == 0                                                \
+            ? 0                                                                                  \
+            : arraylist_segment_of(arraylist->capacity - 1, &offset) + 1;                        \
+        while (arraylist->capacity < new_capacity) {                                             \
+            size_t bytes;                                                                        \
+            if (segment == ARRAYLIST_MAX_SEGMENTS ||                                             \
+                __builtin_mul_overflow(arraylist_segment_size(segment), sizeof(type), &bytes)) { \
+                return MEMORY_ERROR_##name;                                                      \
+            }                                                                                    \
+            type *slots = arraylist_allocate(arraylist->allocator, bytes);                       \
+            if (slots == NULL) {                                                                 \
+                return MEMORY_ERROR_##name;                                                      \
+            }                                                                                    \
+            ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                                          \
+            ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                              \
+            arraylist->segments[segment] = slots;                                                \
+            arraylist->capacity += arraylist_segment_size(segment);                              \
+            segment += 1;                                                                        \
+        }                                                                                        \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                        \
+        return SUCCESS_##name;                                                                   \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_capacity_and_allocator_##name(         \
+        size_t capacity, ArrayListAllocator *allocator) {                                        \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name));   \
+        if (arraylist == NULL) {                                                                 \
+            return NULL;                                                                         \
+        }                                                                                        \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                              \
+        if (arraylist_grow_##name(arraylist, capacity) != SUCCESS_##name) {                      \
+            arraylist_deinit_##name(arraylist);                                                  \
+            arraylist_deallocate(allocator, arraylist, sizeof(ArrayList_##name));                \
+            return NULL;                                                                         \
+        }                                                                                        \
+        return arraylist;                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_capacity_##name(size_t capacity) {     \
+        return arraylist_create_with_capacity_and_allocator_##name(capacity, NULL);              \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_allocator_##name(                      \
+        ArrayListAllocator *allocator) {                                                         \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, allocator); \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_##name() {                                  \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, NULL);      \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_remove_last_<name>(ArrayList_<name> *arraylist, type *out)`.
+ * Generates the segmented versions of `arraylist_get_<name>`, `arraylist_get_first_<name>`,
+ * `arraylist_get_last_<name>`, `arraylist_at_unchecked_<name>` and `arraylist_set_<name>`, and
+ * `type *arraylist_address_of_<name>(ArrayList_<name> *arraylist, size_t index)`, which returns
+ * where an element lives, or NULL if `index` is out of bounds. That address stays valid until the
+ * element is removed.
  */
-#define GENERATE_ARRAYLIST_REMOVE_LAST(name, type)                            \
-    static inline ArrayListError_##name arraylist_remove_last_##name(         \
-        ArrayList_##name *arraylist, type *out) {                             \
-                    if (arraylist->count == 0) {                              \
-            return EMPTY_ARRAYLIST_ERROR_##name;                              \
-        }                                                                     \
-        return arraylist_remove_##name(arraylist, arraylist->count - 1, out); \
+#define GENERATE_SEGMENTED_ARRAYLIST_ACCESS(name, type)                                           \
+    static inline type *arraylist_address_of_##name(ArrayList_##name *arraylist, size_t index) {  \
+        if (index >= arraylist->count) {                                                          \
+            return NULL;                                                                          \
+        }                                                                                         \
+        size_t offset;                                                                            \
+        size_t segment = arraylist_segment_of(index, &offset);                                    \
+        return &arraylist->segments[segment][offset];                                             \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_get_##name(                                     \
+        ArrayList_##name *arraylist, size_t index, type *out) {                                   \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                                \
+        if (arraylist->count == 0) {                                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                  \
+        }                                                                                         \
+        if (index >= arraylist->count) {                                                          \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                              \
+        }                                                                                         \
+        if (out != NULL) {                                                                        \
+            *out = *arraylist_address_of_##name(arraylist, index);                                \
+        }                                                                                         \
+        return SUCCESS_##name;                                                                    \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_get_first_##name(                               \
+        ArrayList_##name *arraylist, type *out) {                                                 \
+        return arraylist_get_##name(arraylist, 0, out);                                           \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_get_last_##name(                                \
+        ArrayList_##name *arraylist, type *out) {                                                 \
+        if (arraylist->count == 0) {                                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                  \
+        }                                                                                         \
+        return arraylist_get_##name(arraylist, arraylist->count - 1, out);                        \
+    }                                                                                             \
+                                                                                                  \
+    static inline type arraylist_at_unchecked_##name(ArrayList_##name *arraylist, size_t index) { \
+        ARRAYLIST_DEBUG_ASSERT(index < arraylist->count);                                         \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                                \
+        size_t offset;                                                                            \
+        size_t segment = arraylist_segment_of(index, &offset);                                    \
+        return arraylist->segments[segment][offset];                                              \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_set_##name(                                     \
+        ArrayList_##name *arraylist, size_t index, type new_element, type *out) {                 \
+        if (arraylist->count == 0) {                                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                  \
+        }                                                                                         \
+        if (index >= arraylist->count) {                                                          \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                              \
+        }                                                                                         \
+        type *slot = arraylist_address_of_##name(arraylist, index);                               \
+        if (out != NULL) {                                                                        \
+            *out = *slot;                                                                         \
+        }                                                                                         \
+        *slot = new_element;                                                                      \
+        return SUCCESS_##name;                                                                    \
     }
 
 /*
- * Generates `ArrayListError_<name> arraylist_remove_<name>(ArrayList_<name> *arraylist, size_t index, type *out)`.
+ * Generates `size_t arraylist_segment_count_<name>(ArrayList_<name> *arraylist)`, the number of
+ * segments holding elements, `type *arraylist_segment_<name>(ArrayList_<name> *arraylist, size_t segment, size_t *n)`,
+ * which returns a segment's elements and stores how many of them are in the list in `n`, and the
+ * segmented version of `arraylist_run_<name>`, whose runs stop at segment ends.
  */
-#define GENERATE_ARRAYLIST_REMOVE(name, type)                         \
-    static inline ArrayListError_##name arraylist_remove_##name(      \
-        ArrayList_##name *arraylist, size_t index, type *out) {       \
-        if (arraylist->count == 0) {                                  \
-            return EMPTY_ARRAYLIST_ERROR_##name;                      \
-        }                                                             \
-        if (index >= arraylist->count) {                              \
-            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                  \
-        }                                                             \
-        if (out != NULL) {                                            \
-            *out = arraylist->data[index];                            \
-        }                                                             \
-        memmove(&arraylist->data[index], &arraylist->data[index + 1], \
-                (arraylist->count - index - 1) * sizeof(type));       \
-        arraylist->count -= 1;                                        \
-        return SUCCESS_##name;                                        \
+#define GENERATE_SEGMENTED_ARRAYLIST_SEGMENTS(name, type)                                           \
+    static inline size_t arraylist_segment_count_##name(ArrayList_##name *arraylist) {              \
+        size_t offset;                                                                              \
+        return arraylist->count == 0 ? 0 : arraylist_segment_of(arraylist->count - 1, &offset) + 1; \
+    }                                                                                               \
+                                                                                                    \
+    static inline type *arraylist_segment_##name(                                                   \
+        ArrayList_##name *arraylist, size_t segment, size_t *n) {                                   \
+        if (segment >= arraylist_segment_count_##name(arraylist)) {                                 \
+            *n = 0;                                                                                 \
+            return NULL;                                                                            \
+        }                                                                                           \
+        size_t live = arraylist->count - arraylist_segment_start(segment);                          \
+        *n = live < arraylist_segment_size(segment) ? live : arraylist_segment_size(segment);       \
+        return arraylist->segments[segment];                                                        \
+    }                                                                                               \
+                                                                                                    \
+    static inline size_t arraylist_run_##name(                                                      \
+        ArrayList_##name *arraylist, size_t index, type **ptr) {                                    \
+        if (index >= arraylist->count) {                                                            \
+            return 0;                                                                               \
+        }                                                                                           \
+        size_t offset;                                                                              \
+        size_t segment = arraylist_segment_of(index, &offset);                                      \
+        size_t n       = arraylist->count - index;                                                  \
+        size_t left    = arraylist_segment_size(segment) - offset;                                  \
+        *ptr = &arraylist->segments[segment][offset];                                               \
+        return n < left ? n : left;                                                                 \
     }
 
 /*
- * Generates the full implementation of an ArrayList suffixed by `name` for a given `type`.
+ * Generates the segmented versions of `arraylist_add_last_<name>`, `arraylist_remove_last_<name>`,
+ * `arraylist_clear_<name>` and `arraylist_shrink_to_fit_<name>`, which frees the segments past
+ * the last element.
  */
-#define GENERATE_ARRAYLIST(name, type)          \
-    GENERATE_ARRAYLIST_STRUCT(name, type)       \
-    GENERATE_ARRAYLIST_ERROR_ENUM(name)         \
-    GENERATE_ARRAYLIST_CREATE(name, type)       \
-    GENERATE_ARRAYLIST_DESTROY(name)            \
-    GENERATE_ARRAYLIST_COUNT(name)              \
-    GENERATE_ARRAYLIST_IS_EMPTY(name)           \
-    GENERATE_ARRAYLIST_GET(name, type)          \
-    GENERATE_ARRAYLIST_GET_FIRST(name, type)    \
-    GENERATE_ARRAYLIST_GET_LAST(name, type)     \
-    GENERATE_ARRAYLIST_SET(name, type)          \
-    GENERATE_ARRAYLIST_GROW(name, type)         \
-    GENERATE_ARRAYLIST_ADD(name, type)          \
-    GENERATE_ARRAYLIST_ADD_FIRST(name, type)    \
-    GENERATE_ARRAYLIST_ADD_LAST(name, type)     \
-    GENERATE_ARRAYLIST_REMOVE(name, type)       \
-    GENERATE_ARRAYLIST_REMOVE_FIRST(name, type) \
-    GENERATE_ARRAYLIST_REMOVE_LAST(name, type)
+#define GENERATE_SEGMENTED_ARRAYLIST_ADD_REMOVE(name, type)                                        \
+    static inline ArrayListError_##name arraylist_add_last_##name(                                 \
+        ArrayList_##name *arraylist, type element) {                                               \
+        if (arraylist->count == arraylist->capacity) {                                             \
+            if (arraylist->capacity == SIZE_MAX) {                                                 \
+                return MEMORY_ERROR_##name;                                                        \
+            }                                                                                      \
+            ArrayListError_##name res = arraylist_grow_##name(arraylist, arraylist->capacity + 1); \
+            if (res != SUCCESS_##name) {                                                           \
+                return res;                                                                        \
+            }                                                                                      \
+        }                                                                                          \
+        size_t offset;                                                                             \
+        size_t segment = arraylist_segment_of(arraylist->count, &offset);                          \
+        arraylist->segments[segment][offset] = element;                                            \
+        arraylist->count += 1;                                                                     \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                 \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                          \
+        return SUCCESS_##name;                                                                     \
+    }                                                                                              \
+                                                                                                   \
+    static inline ArrayListError_##name arraylist_remove_last_##name(                              \
+        ArrayList_##name *arraylist, type *out) {                                                  \
+        if (arraylist->count == 0) {                                                               \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                   \
+        }                                                                                          \
+        if (out != NULL) {                                                                         \
+            *out = *arraylist_address_of_##name(arraylist, arraylist->count - 1);                  \
+        }                                                                                          \
+        arraylist->count -= 1;                                                                     \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                              \
+        return SUCCESS_##name;                                                                     \
+    }                                                                                              \
+                                                                                                   \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) {                       \
+        arraylist->count = 0;                                                                      \
+    }                                                                                              \
+                                                                                                   \
+    static inline ArrayListError_##name arraylist_shrink_to_fit_##name(                            \
+        ArrayList_##name *arraylist) {                                                             \
+        size_t offset;                                                                             \
+        size_t keep = arraylist_segment_count_##name(arraylist);                                   \
+        while (arraylist->capacity > arraylist_segment_start(keep)) {                              \
+            size_t segment = arraylist_segment_of(arraylist->capacity - 1, &offset);               \
+            arraylist_deallocate(arraylist->allocator, arraylist->segments[segment],               \
+                                 arraylist_segment_size(segment) * sizeof(type));                  \
+            arraylist->segments[segment] = NULL;                                                   \
+            arraylist->capacity -= arraylist_segment_size(segment);                                \
+        }                                                                                          \
+        return SUCCESS_##name;                                                                     \
+    }
+
+/*
+ * Generates an ArrayList suffixed by `name` for a given `type`, stored in segments of doubling size
+ * that are allocated as the list grows and never move. Element addresses stay stable, an append
+ * allocates at most one segment and copies nothing, and indexing is O(1).
+ * It provides create/destroy/init/deinit, count/capacity/is_empty, get/set/get_first/get_last,
+ * at_unchecked, address_of, reserve, shrink_to_fit, clear, add_last/remove_last and per-segment
+ * access; the elements are not contiguous, so the rest of the `GENERATE_ARRAYLIST` API is not available.
+ */
+#define GENERATE_SEGMENTED_ARRAYLIST(name, type)      \
+    GENERATE_SEGMENTED_ARRAYLIST_STRUCT(name, type)   \
+    GENERATE_ARRAYLIST_STATS(name)                    \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)               \
+    GENERATE_SEGMENTED_ARRAYLIST_LIFETIME(name, type) \
+    GENERATE_ARRAYLIST_DESTROY(name, type)            \
+    GENERATE_ARRAYLIST_COUNT(name)                    \
+    GENERATE_ARRAYLIST_CAPACITY(name)                 \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)                 \
+    GENERATE_SEGMENTED_ARRAYLIST_ACCESS(name, type)   \
+    GENERATE_ARRAYLIST_RESERVE(name, type)            \
+    GENERATE_SEGMENTED_ARRAYLIST_SEGMENTS(name, type) \
+    GENERATE_ARRAYLIST_ITER(name, type)               \
+    GENERATE_SEGMENTED_ARRAYLIST_ADD_REMOVE(name, type)
+
+/*
+ * Generate `struct arraylist_<name>_t` for a bit-packed list. The first `block_count` blocks of
+ * values are packed into `words`; the `count - block_count * ARRAYLIST_PACKED_BLOCK` values after
+ * them wait in `tail` until it fills.
+ */
+#define GENERATE_PACKED_ARRAYLIST_STRUCT(name, type)        \
+    typedef struct arraylist_##name##_t {                   \
+        ArrayListPackedBlock *blocks;                       \
+        size_t                block_count;                  \
+        size_t                block_capacity;               \
+        uint64_t             *words;                        \
+        size_t                word_count;                   \
+        size_t                word_capacity;                \
+        size_t                count;                        \
+        type                  tail[ARRAYLIST_PACKED_BLOCK]; \
+        ArrayListAllocator   *allocator;                    \
+        ARRAYLIST_STATS_MEMBER                              \
+    } ArrayList_##name;
+
+/*
+ * Generates the packed versions of `arraylist_init_with_allocator_<name>`, `arraylist_init_<name>`,
+ * `arraylist_deinit_<name>` and the `arraylist_create_*_<name>` family; growing the block table and
+ * the packed words, and mapping values to unsigned keys that keep their order.
+ */
+#define GENERATE_PACKED_ARRAYLIST_LIFETIME(name, type)                                                   \
+    _Static_assert((type)0.5 == 0 && sizeof(type) <= 8,                                                  \
+                   "GENERATE_PACKED_ARRAYLIST needs an integer type of at most 8 bytes");                \
+                                                                                                         \
+    static inline uint64_t arraylist_packed_key_##name(type value) {                                     \
+        return (type)-1 < (type)1 ? (uint64_t)(int64_t)value ^ ((uint64_t)1 << 63) : (uint64_t)value;    \
+    }                                                                                                    \
+                                                                                                         \
+    static inline type arraylist_packed_value_##name(uint64_t key) {                                     \
+        return (type)-1 < (type)1 ? (type)(int64_t)(key ^ ((uint64_t)1 << 63)) : (type)key;              \
+    }                                                                                                    \
+                                                                                                         \
+    static inline void arraylist_init_with_allocator_##name(                                             \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {                                    \
+        arraylist->blocks         = NULL;                                                                \
+        arraylist->block_count    = 0;                                                                   \
+        arraylist->block_capacity = 0;                                                                   \
+        arraylist->words          = NULL;                                                                \
+        arraylist->word_count     = 0;                                                                   \
+        arraylist->word_capacity  = 0;                                                                   \
+        arraylist->count          = 0;                                                                   \
+        arraylist->allocator      = allocator;                                                           \
+        ARRAYLIST_STATS_RESET(arraylist);                                                                \
+    }                                                                                                    \
+                                                                                                         \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {                              \
+        arraylist_init_with_allocator_##name(arraylist, NULL);                                           \
+    }                                                                                                    \
+                                                                                                         \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) {                            \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                                           \
+        ARRAYLIST_STATS_RESET(arraylist);                                                                \
+        arraylist_deallocate(arraylist->allocator, arraylist->blocks,                                    \
+                             arraylist->block_capacity * sizeof(ArrayListPackedBlock));                  \
+        arraylist_deallocate(arraylist->allocator, arraylist->words,                                     \
+                             arraylist->word_capacity * sizeof(uint64_t));                               \
+        arraylist_init_with_allocator_##name(arraylist, arraylist->allocator);                           \
+    }                                                                                                    \
+                                                                                                         \
+    /* Makes room for one more block of `words` words, growing each array by 1.5x when full. */          \
+    static inline ArrayListError_##name arraylist_packed_reserve_##name(                                 \
+        ArrayList_##name *arraylist, size_t words) {                                                     \
+        if (arraylist->block_count == arraylist->block_capacity) {                                       \
+            size_t capacity = arraylist_next_capacity(arraylist->block_capacity,                         \
+                                                      arraylist->block_count + 1,                        \
+                                                      sizeof(ArrayListPackedBlock),                      \
+                                                      ARRAYLIST_GROWTH_1_5X);                            \
+            size_t bytes;                                                                                \
+            if (__builtin_mul_overflow(capacity, sizeof(ArrayListPackedBlock), &bytes)) {                \
+                return MEMORY_ERROR_##name;                                                              \
+            }                                                                                            \
+            ArrayListPackedBlock *blocks = arraylist_reallocate(                                         \
+                arraylist->allocator, arraylist->blocks,                                                 \
+                arraylist->block_capacity * sizeof(ArrayListPackedBlock), bytes);                        \
+            if (blocks == NULL) {                                                                        \
+                return MEMORY_ERROR_##name;                                                              \
+            }                                                                                            \
+            ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                                                  \
+            ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                                      \
+            arraylist->blocks         = blocks;                                                          \
+            arraylist->block_capacity = capacity;                                                        \
+        }                                                                                                \
+        if (arraylist->word_capacity - arraylist->word_count < words) {                                  \
+            size_t capacity = arraylist_next_capacity(arraylist->word_capacity,                          \
+                                                      arraylist->word_count + words,                     \
+                                                      sizeof(uint64_t), ARRAYLIST_GROWTH_1_5X);          \
+            size_t bytes;                                                                                \
+            if (__builtin_mul_overflow(capacity, sizeof(uint64_t), &bytes)) {                            \
+                return MEMORY_ERROR_##name;                                                              \
+            }                                                                                            \
+            uint64_t *packed = arraylist_reallocate(arraylist->allocator, arraylist->words,              \
+                                                    arraylist->word_capacity * sizeof(uint64_t), bytes); \
+            if (packed == NULL) {                                                                        \
+                return MEMORY_ERROR_##name;                                                              \
+            }                                                                                            \
+            ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                                                  \
+            ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, bytes);                                      \
+            arraylist->words         = packed;                                                           \
+            arraylist->word_capacity = capacity;                                                         \
+        }                                                                                                \
+        return SUCCESS_##name;                                                                           \
+    }                                                                                                    \
+                                                                                                         \
+    static inline ArrayList_##name *arraylist_create_with_allocator_##name(                              \
+        ArrayListAllocator *allocator) {                                                                 \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name));           \
+        if (arraylist == NULL) {                                                                         \
+            return NULL;                                                                                 \
+        }                                                                                                \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                                      \
+        return arraylist;                                                                                \
+    }                                                                                                    \
+                                                                                                         \
+    static inline ArrayList_##name *arraylist_create_##name() {                                          \
+        return arraylist_create_with_allocator_##name(NULL);                                             \
+    }
+
+/*
+ * Generates the packed versions of `arraylist_get_<name>`, `arraylist_get_first_<name>`,
+ * `arraylist_get_last_<name>` and `arraylist_at_unchecked_<name>`, which unpack a single value.
+ */
+#define GENERATE_PACKED_ARRAYLIST_ACCESS(name, type)                                              \
+    static inline type arraylist_at_unchecked_##name(ArrayList_##name *arraylist, size_t index) { \
+        ARRAYLIST_DEBUG_ASSERT(index < arraylist->count);                                         \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                                \
+        size_t block = index >> ARRAYLIST_PACKED_BLOCK_SHIFT;                                     \
+        if (block == arraylist->block_count) {                                                    \
+            return arraylist->tail[index & (ARRAYLIST_PACKED_BLOCK - 1)];                         \
+        }                                                                                         \
+        const ArrayListPackedBlock *packed = &arraylist->blocks[block];                           \
+        uint64_t offset = arraylist_packed_at(&arraylist->words[packed->offset], packed->width,   \
+                                              index & (ARRAYLIST_PACKED_BLOCK - 1));              \
+        return arraylist_packed_value_##name(packed->base + offset);                              \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_get_##name(                                     \
+        ArrayList_##name *arraylist, size_t index, type *out) {                                   \
+        if (arraylist->count == 0) {                                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                  \
+        }                                                                                         \
+        if (index >= arraylist->count) {                                                          \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                              \
+        }                                                                                         \
+        type element = arraylist_at_unchecked_##name(arraylist, index);                           \
+        if (out != NULL) {                                                                        \
+            *out = element;                                                                       \
+        }                                                                                         \
+        return SUCCESS_##name;                                                                    \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_get_first_##name(                               \
+        ArrayList_##name *arraylist, type *out) {                                                 \
+        return arraylist_get_##name(arraylist, 0, out);                                           \
+    }                                                                                             \
+                                                                                                  \
+    static inline ArrayListError_##name arraylist_get_last_##name(                                \
+        ArrayList_##name *arraylist, type *out) {                                                 \
+        if (arraylist->count == 0) {                                                              \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                  \
+        }                                                                                         \
+        return arraylist_get_##name(arraylist, arraylist->count - 1, out);                        \
+    }
+
+/*
+ * Generates `size_t arraylist_block_count_<name>(ArrayList_<name> *arraylist)`, the number of
+ * blocks holding elements, the last of which may be partly filled,
+ * `size_t arraylist_decode_block_<name>(ArrayList_<name> *arraylist, size_t block, type *out)`,
+ * which unpacks a block into `out` (room for `ARRAYLIST_PACKED_BLOCK` elements) and returns how many
+ * elements it holds, and `size_t arraylist_packed_bytes_<name>(ArrayList_<name> *arraylist)`, the
+ * heap memory the list is using.
+ */
+#define GENERATE_PACKED_ARRAYLIST_BLOCKS(name, type)                                                   \
+    static inline size_t arraylist_block_count_##name(ArrayList_##name *arraylist) {                   \
+        return (arraylist->count + ARRAYLIST_PACKED_BLOCK - 1) >> ARRAYLIST_PACKED_BLOCK_SHIFT;        \
+    }                                                                                                  \
+                                                                                                       \
+    static inline size_t arraylist_decode_block_##name(                                                \
+        ArrayList_##name *arraylist, size_t block, type *out) {                                        \
+        if (block > arraylist->block_count) {                                                          \
+            return 0;                                                                                  \
+        }                                                                                              \
+        if (block == arraylist->block_count) {                                                         \
+            size_t n = arraylist->count - (block << ARRAYLIST_PACKED_BLOCK_SHIFT);                     \
+            memcpy(out, arraylist->tail, n * sizeof(type));                                            \
+            return n;                                                                                  \
+        }                                                                                              \
+        const ArrayListPackedBlock *packed = &arraylist->blocks[block];                                \
+        uint64_t keys[ARRAYLIST_PACKED_BLOCK];                                                         \
+        arraylist_packed_decode(&arraylist->words[packed->offset], packed->base, packed->width, keys); \
+        for (size_t i = 0; i < ARRAYLIST_PACKED_BLOCK; i++) {                                          \
+            out[i] = arraylist_packed_value_##name(keys[i]);                                           \
+        }                                                                                              \
+        return ARRAYLIST_PACKED_BLOCK;                                                                 \
+    }                                                                                                  \
+                                                                                                       \
+    static inline size_t arraylist_packed_bytes_##name(ArrayList_##name *arraylist) {                  \
+        return arraylist->block_capacity * sizeof(ArrayListPackedBlock) +                              \
+               arraylist->word_capacity * sizeof(uint64_t);                                            \
+    }
+
+/*
+ * Generates the packed versions of `arraylist_add_last_<name>`, `arraylist_remove_last_<name>`,
+ * `arraylist_clear_<name>` and `arraylist_shrink_to_fit_<name>`. The add that fills the tail packs it
+ * into a new block; removing from an empty tail unpacks the last block back into it.
+ */
+#define GENERATE_PACKED_ARRAYLIST_ADD_REMOVE(name, type)                                             \
+    static inline ArrayListError_##name arraylist_add_last_##name(                                   \
+        ArrayList_##name *arraylist, type element) {                                                 \
+        size_t n = arraylist->count - (arraylist->block_count << ARRAYLIST_PACKED_BLOCK_SHIFT);      \
+        arraylist->tail[n] = element;                                                                \
+        if (n + 1 == ARRAYLIST_PACKED_BLOCK) {                                                       \
+            uint64_t keys[ARRAYLIST_PACKED_BLOCK];                                                   \
+            uint64_t lo = UINT64_MAX;                                                                \
+            uint64_t hi = 0;                                                                         \
+            for (size_t i = 0; i < ARRAYLIST_PACKED_BLOCK; i++) {                                    \
+                keys[i] = arraylist_packed_key_##name(arraylist->tail[i]);                           \
+                lo = keys[i] < lo ? keys[i] : lo;                                                    \
+                hi = keys[i] > hi ? keys[i] : hi;                                                    \
+            }                                                                                        \
+            unsigned width = arraylist_packed_width(hi - lo);                                        \
+            ArrayListError_##name res =                                                              \
+                arraylist_packed_reserve_##name(arraylist, ARRAYLIST_PACKED_LANES * width);          \
+            if (res != SUCCESS_##name) {                                                             \
+                return res;                                                                          \
+            }                                                                                        \
+            ArrayListPackedBlock *packed = &arraylist->blocks[arraylist->block_count];               \
+            packed->base   = lo;                                                                     \
+            packed->offset = arraylist->word_count;                                                  \
+            packed->width  = width;                                                                  \
+            arraylist_packed_encode(&arraylist->words[packed->offset], keys, lo, width);             \
+            arraylist->word_count  += ARRAYLIST_PACKED_LANES * width;                                \
+            arraylist->block_count += 1;                                                             \
+        }                                                                                            \
+        arraylist->count += 1;                                                                       \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                   \
+        return SUCCESS_##name;                                                                       \
+    }                                                                                                \
+                                                                                                     \
+    static inline ArrayListError_##name arraylist_remove_last_##name(                                \
+        ArrayList_##name *arraylist, type *out) {                                                    \
+        if (arraylist->count == 0) {                                                                 \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                     \
+        }                                                                                            \
+        if (arraylist->count == arraylist->block_count << ARRAYLIST_PACKED_BLOCK_SHIFT) {            \
+            size_t block = arraylist->block_count - 1;                                               \
+            arraylist_decode_block_##name(arraylist, block, arraylist->tail);                        \
+            arraylist->word_count  = arraylist->blocks[block].offset;                                \
+            arraylist->block_count = block;                                                          \
+        }                                                                                            \
+        arraylist->count -= 1;                                                                       \
+        if (out != NULL) {                                                                           \
+            *out = arraylist->tail[arraylist->count & (ARRAYLIST_PACKED_BLOCK - 1)];                 \
+        }                                                                                            \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                \
+        return SUCCESS_##name;                                                                       \
+    }                                                                                                \
+                                                                                                     \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) {                         \
+        arraylist->block_count = 0;                                                                  \
+        arraylist->word_count  = 0;                                                                  \
+        arraylist->count       = 0;                                                                  \
+    }                                                                                                \
+                                                                                                     \
+    static inline ArrayListError_##name arraylist_shrink_to_fit_##name(                              \
+        ArrayList_##name *arraylist) {                                                               \
+        if (arraylist->block_capacity > arraylist->block_count) {                                    \
+            size_t bytes = arraylist->block_count * sizeof(ArrayListPackedBlock);                    \
+            if (bytes == 0) {                                                                        \
+                arraylist_deallocate(arraylist->allocator, arraylist->blocks,                        \
+                                     arraylist->block_capacity * sizeof(ArrayListPackedBlock));      \
+                arraylist->blocks = NULL;                                                            \
+            } else {                                                                                 \
+                ArrayListPackedBlock *blocks = arraylist_reallocate(                                 \
+                    arraylist->allocator, arraylist->blocks,                                         \
+                    arraylist->block_capacity * sizeof(ArrayListPackedBlock), bytes);                \
+                if (blocks == NULL) {                                                                \
+                    return MEMORY_ERROR_##name;                                                      \
+                }                                                                                    \
+                arraylist->blocks = blocks;                                                          \
+            }                                                                                        \
+            arraylist->block_capacity = arraylist->block_count;                                      \
+        }                                                                                            \
+        if (arraylist->word_capacity > arraylist->word_count) {                                      \
+            size_t bytes = arraylist->word_count * sizeof(uint64_t);                                 \
+            if (bytes == 0) {                                                                        \
+                arraylist_deallocate(arraylist->allocator, arraylist->words,                         \
+                                     arraylist->word_capacity * sizeof(uint64_t));                   \
+                arraylist->words = NULL;                                                             \
+            } else {                                                                                 \
+                uint64_t *packed = arraylist_reallocate(arraylist->allocator, arraylist->words,      \
+                                                        arraylist->word_capacity * sizeof(uint64_t), \
+                                                        bytes);                                      \
+                if (packed == NULL) {                                                                \
+                    return MEMORY_ERROR_##name;                                                      \
+                }                                                                                    \
+                arraylist->words = packed;                                                           \
+            }                                                                                        \
+            arraylist->word_capacity = arraylist->word_count;                                        \
+        }                                                                                            \
+        return SUCCESS_##name;                                                                       \
+    }
+
+/*
+ * Generates an ArrayList suffixed by `name` for an integer `type` of at most 8 bytes, stored
+ * compressed: every block of `ARRAYLIST_PACKED_BLOCK` values is bit-packed as offsets from the
+ * block's smallest value, so values spanning a 16-bit range take about 2 bytes each.
+ * It provides create/destroy/init/deinit, count/is_empty, get/get_first/get_last, at_unchecked,
+ * add_last/remove_last, clear, shrink_to_fit and whole-block decoding. Elements have no addresses
+ * and cannot be changed in place, so the rest of the `GENERATE_ARRAYLIST` API is not available.
+ */
+#define GENERATE_PACKED_ARRAYLIST(name, type)      \
+    GENERATE_PACKED_ARRAYLIST_STRUCT(name, type)   \
+    GENERATE_ARRAYLIST_STATS(name)                 \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)            \
+    GENERATE_PACKED_ARRAYLIST_LIFETIME(name, type) \
+    GENERATE_ARRAYLIST_DESTROY(name, type)         \
+    GENERATE_ARRAYLIST_COUNT(name)                 \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)              \
+    GENERATE_PACKED_ARRAYLIST_ACCESS(name, type)   \
+    GENERATE_PACKED_ARRAYLIST_BLOCKS(name, type)   \
+    GENERATE_PACKED_ARRAYLIST_ADD_REMOVE(name, type)
+
+/*
+ * Field iteration for `GENERATE_SOA_ARRAYLIST`. `ARRAYLIST_FOR_EACH_FIELD(m, name, (t1, f1), (t2, f2), ...)`
+ * expands to `m(name, t1, f1) m(name, t2, f2) ...`, for up to 16 fields.
+ */
+#define ARRAYLIST_UNPAREN(...) __VA_ARGS__
+#define ARRAYLIST_CONCAT_(a, b) a##b
+#define ARRAYLIST_CONCAT(a, b) ARRAYLIST_CONCAT_(a, b)
+#define ARRAYLIST_FIELD_CALL(m, name, ...) m(name, __VA_ARGS__)
+#define ARRAYLIST_APPLY_FIELD(m, name, field) ARRAYLIST_FIELD_CALL(m, name, ARRAYLIST_UNPAREN field)
+#define ARRAYLIST_COUNT_FIELDS_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, n, ...) n
+#define ARRAYLIST_COUNT_FIELDS(...) \
+    ARRAYLIST_COUNT_FIELDS_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define ARRAYLIST_FOR_EACH_FIELD_1(m, name, f) ARRAYLIST_APPLY_FIELD(m, name, f)
+#define ARRAYLIST_FOR_EACH_FIELD_2(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_1(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_3(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_2(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_4(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_3(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_5(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_4(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_6(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_5(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_7(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_6(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_8(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_7(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_9(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_8(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_10(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_9(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_11(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_10(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_12(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_11(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_13(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_12(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_14(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_13(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_15(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_14(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD_16(m, name, f, ...) ARRAYLIST_APPLY_FIELD(m, name, f) ARRAYLIST_FOR_EACH_FIELD_15(m, name, __VA_ARGS__)
+#define ARRAYLIST_FOR_EACH_FIELD(m, name, ...) \
+    ARRAYLIST_CONCAT(ARRAYLIST_FOR_EACH_FIELD_, ARRAYLIST_COUNT_FIELDS(__VA_ARGS__))(m, name, __VA_ARGS__)
+
+/*
+ * Bytes taken by one column of `capacity` elements. Columns are padded to whole cache lines so every
+ * column of a structure-of-arrays block starts cache-aligned relative to the block.
+ */
+static inline bool arraylist_soa_column_bytes(size_t capacity, size_t element_size, size_t *bytes) {
+    size_t padded;
+    if (__builtin_mul_overflow(capacity, element_size, bytes) ||
+        __builtin_add_overflow(*bytes, (size_t)ARRAYLIST_CACHE_LINE - 1, &padded)) {
+        return false;
+    }
+    *bytes = padded & ~((size_t)ARRAYLIST_CACHE_LINE - 1);
+    return true;
+}
+
+/*
+ * Per-field pieces of `GENERATE_SOA_ARRAYLIST`, applied with `ARRAYLIST_FOR_EACH_FIELD`.
+ */
+#define ARRAYLIST_SOA_RECORD_MEMBER(name, type, field) type field;
+#define ARRAYLIST_SOA_COLUMN_MEMBER(name, type, field) type *field;
+#define ARRAYLIST_SOA_NULL(name, type, field) arraylist->columns.field = NULL;
+#define ARRAYLIST_SOA_SIZE(name, type, field) \
+    ok = ok && arraylist_soa_column_bytes(capacity, sizeof(type), &bytes) && !__builtin_add_overflow(*size, bytes, size);
+#define ARRAYLIST_SOA_BIND(name, type, field)                    \
+    arraylist->columns.field = (type *)((char *)block + offset); \
+    offset += (capacity * sizeof(type) + ARRAYLIST_CACHE_LINE - 1) & ~((size_t)ARRAYLIST_CACHE_LINE - 1);
+#define ARRAYLIST_SOA_COPY(name, type, field) \
+    memcpy(next.columns.field, arraylist->columns.field, arraylist->count * sizeof(type));
+#define ARRAYLIST_SOA_LOAD(name, type, field) out->field = arraylist->columns.field[index];
+#define ARRAYLIST_SOA_STORE(name, type, field) arraylist->columns.field[index] = element.field;
+#define ARRAYLIST_SOA_INSERT(name, type, field)                                     \
+    memmove(&arraylist->columns.field[index + 1], &arraylist->columns.field[index], \
+            (arraylist->count - index) * sizeof(type));
+#define ARRAYLIST_SOA_ERASE(name, type, field)                                      \
+    memmove(&arraylist->columns.field[index], &arraylist->columns.field[index + 1], \
+            (arraylist->count - index - 1) * sizeof(type));
+#define ARRAYLIST_SOA_MOVE_LAST(name, type, field) \
+    arraylist->columns.field[index] = arraylist->columns.field[arraylist->count - 1];
+#define ARRAYLIST_SOA_COLUMN_FN(name, type, field)                                       \
+    static inline type *arraylist_column_##name##_##field(ArrayList_##name *arraylist) { \
+        return arraylist->columns.field;                                                 \
+    }
+
+/*
+ * Generate `struct arraylist_record_<name>_t`, one row of the list, and `struct arraylist_<name>_t`,
+ * which holds one column per field. All columns live in a single block of `capacity` rows.
+ */
+#define GENERATE_SOA_ARRAYLIST_STRUCT(name, ...)                                     \
+    typedef struct arraylist_record_##name##_t {                                     \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_RECORD_MEMBER, name, __VA_ARGS__)     \
+    } ArrayListRecord_##name;                                                        \
+                                                                                     \
+    typedef struct arraylist_##name##_t {                                            \
+        struct {                                                                     \
+            ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_COLUMN_MEMBER, name, __VA_ARGS__) \
+        } columns;                                                                   \
+        void                 *block;                                                 \
+        size_t                count;                                                 \
+        size_t                capacity;                                              \
+        ArrayListAllocator   *allocator;                                             \
+        ArrayListGrowthPolicy growth_policy;                                         \
+        ARRAYLIST_STATS_MEMBER                                                       \
+    } ArrayList_##name;
+
+/*
+ * Generates `bool arraylist_soa_size_<name>(size_t capacity, size_t *size)`, which computes the
+ * block size for `capacity` rows and returns false on overflow, and
+ * `void arraylist_soa_bind_<name>(ArrayList_<name> *arraylist, void *block, size_t capacity)`,
+ * which points the columns into `block`.
+ */
+#define GENERATE_SOA_ARRAYLIST_LAYOUT(name, ...)                                                              \
+    static inline bool arraylist_soa_size_##name(size_t capacity, size_t *size) {                             \
+        size_t bytes;                                                                                         \
+        bool ok = true;                                                                                       \
+        *size = 0;                                                                                            \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_SIZE, name, __VA_ARGS__)                                       \
+        return ok;                                                                                            \
+    }                                                                                                         \
+                                                                                                              \
+    static inline void arraylist_soa_bind_##name(ArrayList_##name *arraylist, void *block, size_t capacity) { \
+        size_t offset = 0;                                                                                    \
+        arraylist->block = block;                                                                             \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_BIND, name, __VA_ARGS__)                                       \
+    }
+
+/*
+ * Generates `void arraylist_init_with_allocator_<name>(ArrayList_<name> *arraylist, ArrayListAllocator *allocator)`,
+ * `void arraylist_init_<name>(ArrayList_<name> *arraylist)`,
+ * `void arraylist_free_data_<name>(ArrayList_<name> *arraylist)` and
+ * `void arraylist_deinit_<name>(ArrayList_<name> *arraylist)`.
+ */
+#define GENERATE_SOA_ARRAYLIST_INIT(name, ...)                                   \
+    static inline void arraylist_init_with_allocator_##name(                     \
+        ArrayList_##name *arraylist, ArrayListAllocator *allocator) {            \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_NULL, name, __VA_ARGS__)          \
+        arraylist->block         = NULL;                                         \
+        arraylist->count         = 0;                                            \
+        arraylist->capacity      = 0;                                            \
+        arraylist->allocator     = allocator;                                    \
+        arraylist->growth_policy = ARRAYLIST_GROWTH_1_5X;                        \
+        ARRAYLIST_STATS_RESET(arraylist);                                        \
+    }                                                                            \
+                                                                                 \
+    static inline void arraylist_init_##name(ArrayList_##name *arraylist) {      \
+        arraylist_init_with_allocator_##name(arraylist, NULL);                   \
+    }                                                                            \
+                                                                                 \
+    static inline void arraylist_free_data_##name(ArrayList_##name *arraylist) { \
+        size_t size;                                                             \
+        arraylist_soa_size_##name(arraylist->capacity, &size);                   \
+        arraylist_deallocate(arraylist->allocator, arraylist->block, size);      \
+    }                                                                            \
+                                                                                 \
+    static inline void arraylist_deinit_##name(ArrayList_##name *arraylist) {    \
+        arraylist_free_data_##name(arraylist);                                   \
+        ARRAYLIST_STATS_FOLD(name, arraylist);                                   \
+        arraylist_init_with_allocator_##name(arraylist, arraylist->allocator);   \
+    }                                                                            \
+                                                                                 \
+    static inline void arraylist_clear_##name(ArrayList_##name *arraylist) {     \
+        arraylist->count = 0;                                                    \
+    }
+
+/*
+ * Generates `ArrayListError_<name> arraylist_grow_<name>(ArrayList_<name> *arraylist, size_t new_capacity)`.
+ * Every column moves to one new block, so a failed grow leaves the list unchanged.
+ */
+#define GENERATE_SOA_ARRAYLIST_GROW(name, ...)                              \
+    static inline ArrayListError_##name arraylist_grow_##name(              \
+        ArrayList_##name *arraylist, size_t new_capacity) {                 \
+        assert(new_capacity > arraylist->capacity);                         \
+        size_t size;                                                        \
+        if (!arraylist_soa_size_##name(new_capacity, &size)) {              \
+            return MEMORY_ERROR_##name;                                     \
+        }                                                                   \
+        void *block = arraylist_allocate(arraylist->allocator, size);       \
+        if (block == NULL) {                                                \
+            return MEMORY_ERROR_##name;                                     \
+        }                                                                   \
+        ARRAYLIST_STATS_COUNT(arraylist, grows, 1);                         \
+        ARRAYLIST_STATS_COUNT(arraylist, realloc_bytes, size);              \
+        ArrayList_##name next = *arraylist;                                 \
+        arraylist_soa_bind_##name(&next, block, new_capacity);              \
+        if (arraylist->count > 0) {                                         \
+            ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_COPY, name, __VA_ARGS__) \
+        }                                                                   \
+        arraylist_free_data_##name(arraylist);                              \
+        next.capacity = new_capacity;                                       \
+        *arraylist    = next;                                               \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                   \
+        return SUCCESS_##name;                                              \
+    }
+
+/*
+ * Generates `ArrayList_<name> *arraylist_create_with_capacity_and_allocator_<name>(size_t capacity, ArrayListAllocator *allocator)`,
+ * `ArrayList_<name> *arraylist_create_with_capacity_<name>(size_t capacity)`,
+ * `ArrayList_<name> *arraylist_create_with_allocator_<name>(ArrayListAllocator *allocator)`
+ * and `ArrayList_<name> *arraylist_create_<name>()`.
+ */
+#define GENERATE_SOA_ARRAYLIST_CREATE(name)                                                      \
+    static inline ArrayList_##name *arraylist_create_with_capacity_and_allocator_##name(         \
+        size_t capacity, ArrayListAllocator *allocator) {                                        \
+        ArrayList_##name *arraylist = arraylist_allocate(allocator, sizeof(ArrayList_##name));   \
+        if (arraylist == NULL) {                                                                 \
+            return NULL;                                                                         \
+        }                                                                                        \
+        arraylist_init_with_allocator_##name(arraylist, allocator);                              \
+        if (capacity > 0 && arraylist_grow_##name(arraylist, capacity) != SUCCESS_##name) {      \
+            arraylist_deallocate(allocator, arraylist, sizeof(ArrayList_##name));                \
+            return NULL;                                                                         \
+        }                                                                                        \
+        return arraylist;                                                                        \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_capacity_##name(size_t capacity) {     \
+        return arraylist_create_with_capacity_and_allocator_##name(capacity, NULL);              \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_with_allocator_##name(                      \
+        ArrayListAllocator *allocator) {                                                         \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, allocator); \
+    }                                                                                            \
+                                                                                                 \
+    static inline ArrayList_##name *arraylist_create_##name() {                                  \
+        return arraylist_create_with_capacity_and_allocator_##name(INITIAL_CAPACITY, NULL);      \
+    }
+
+/*
+ * Generates `arraylist_get_<name>`, `arraylist_set_<name>`, `arraylist_add_<name>`, `arraylist_remove_<name>`
+ * and `arraylist_swap_remove_<name>`, which take and return whole `ArrayListRecord_<name>` rows.
+ */
+#define GENERATE_SOA_ARRAYLIST_ACCESS(name, ...)                                                        \
+    static inline ArrayListError_##name arraylist_get_##name(                                           \
+        ArrayList_##name *arraylist, size_t index, ArrayListRecord_##name *out) {                       \
+        ARRAYLIST_STATS_COUNT(arraylist, gets, 1);                                                      \
+        if (arraylist->count == 0) {                                                                    \
+            return EMPTY_ARRAYLIST_ERROR_##name;                                                        \
+        }                                                                                               \
+        if (index >= arraylist->count) {                                                                \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (out != NULL) {                                                                              \
+            ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_LOAD, name, __VA_ARGS__)                             \
+        }                                                                                               \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_set_##name(ArrayList_##name *arraylist, size_t index, \
+        ArrayListRecord_##name element, ArrayListRecord_##name *out) {                                  \
+        ArrayListError_##name res = arraylist_get_##name(arraylist, index, out);                        \
+        if (res != SUCCESS_##name) {                                                                    \
+            return res;                                                                                 \
+        }                                                                                               \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_STORE, name, __VA_ARGS__)                                \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_add_##name(                                           \
+        ArrayList_##name *arraylist, size_t index, ArrayListRecord_##name element) {                    \
+        if (index > arraylist->count) {                                                                 \
+            return INDEX_OUT_OF_BOUNDS_ERROR_##name;                                                    \
+        }                                                                                               \
+        if (arraylist->count == arraylist->capacity) {                                                  \
+            if (arraylist->capacity == SIZE_MAX) {                                                      \
+                return MEMORY_ERROR_##name;                                                             \
+            }                                                                                           \
+            ArrayListError_##name res = arraylist_ensure_capacity_##name(                               \
+                arraylist, arraylist->capacity + 1);                                                    \
+            if (res != SUCCESS_##name) {                                                                \
+                return res;                                                                             \
+            }                                                                                           \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, adds, 1);                                                      \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_INSERT, name, __VA_ARGS__)                               \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_STORE, name, __VA_ARGS__)                                \
+        arraylist->count += 1;                                                                          \
+        ARRAYLIST_STATS_PEAKS(arraylist);                                                               \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_remove_##name(                                        \
+        ArrayList_##name *arraylist, size_t index, ArrayListRecord_##name *out) {                       \
+        ArrayListError_##name res = arraylist_get_##name(arraylist, index, out);                        \
+        if (res != SUCCESS_##name) {                                                                    \
+            return res;                                                                                 \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                   \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_ERASE, name, __VA_ARGS__)                                \
+        arraylist->count -= 1;                                                                          \
+        return SUCCESS_##name;                                                                          \
+    }                                                                                                   \
+                                                                                                        \
+    static inline ArrayListError_##name arraylist_swap_remove_##name(                                   \
+        ArrayList_##name *arraylist, size_t index, ArrayListRecord_##name *out) {                       \
+        ArrayListError_##name res = arraylist_get_##name(arraylist, index, out);                        \
+        if (res != SUCCESS_##name) {                                                                    \
+            return res;                                                                                 \
+        }                                                                                               \
+        ARRAYLIST_STATS_COUNT(arraylist, removes, 1);                                                   \
+        ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_MOVE_LAST, name, __VA_ARGS__)                            \
+        arraylist->count -= 1;                                                                          \
+        return SUCCESS_##name;                                                                          \
+    }
+
+/*
+ * Generates a structure-of-arrays list of `ArrayListRecord_<name>` rows with the fields given as
+ * `(type, field)` pairs, up to 16. Each field is stored in its own contiguous column, reachable with
+ * `type *arraylist_column_<name>_<field>(ArrayList_<name> *arraylist)`, so a scan over one field
+ * only reads that field's memory. Columns grow together with the list's growth policy.
+ */
+#define GENERATE_SOA_ARRAYLIST(name, ...)                            \
+    GENERATE_SOA_ARRAYLIST_STRUCT(name, __VA_ARGS__)                 \
+    GENERATE_ARRAYLIST_STATS(name)                                   \
+    GENERATE_ARRAYLIST_ERROR_ENUM(name)                              \
+    GENERATE_SOA_ARRAYLIST_LAYOUT(name, __VA_ARGS__)                 \
+    GENERATE_SOA_ARRAYLIST_INIT(name, __VA_ARGS__)                   \
+    GENERATE_SOA_ARRAYLIST_GROW(name, __VA_ARGS__)                   \
+    GENERATE_SOA_ARRAYLIST_CREATE(name)                              \
+    GENERATE_ARRAYLIST_DESTROY(name, ArrayListRecord_##name)         \
+    GENERATE_ARRAYLIST_COUNT(name)                                   \
+    GENERATE_ARRAYLIST_CAPACITY(name)                                \
+    GENERATE_ARRAYLIST_IS_EMPTY(name)                                \
+    GENERATE_ARRAYLIST_ENSURE_CAPACITY(name, ArrayListRecord_##name) \
+    GENERATE_ARRAYLIST_RESERVE(name, ArrayListRecord_##name)         \
+    GENERATE_ARRAYLIST_SET_GROWTH_POLICY(name)                       \
+    GENERATE_SOA_ARRAYLIST_ACCESS(name, __VA_ARGS__)                 \
+    GENERATE_ARRAYLIST_ADD_FIRST(name, ArrayListRecord_##name)       \
+    GENERATE_ARRAYLIST_ADD_LAST(name, ArrayListRecord_##name)        \
+    GENERATE_ARRAYLIST_REMOVE_FIRST(name, ArrayListRecord_##name)    \
+    GENERATE_ARRAYLIST_REMOVE_LAST(name, ArrayListRecord_##name)     \
+    ARRAYLIST_FOR_EACH_FIELD(ARRAYLIST_SOA_COLUMN_FN, name, __VA_ARGS__)
 
 /*
  * User-facing macros.
@@ -293,12 +5453,36 @@
 #define ARRAYLIST_CREATE(name) \
     arraylist_create_##name()
 
+#define ARRAYLIST_CREATE_WITH_CAPACITY(name, capacity) \
+    arraylist_create_with_capacity_##name(capacity)
+
+#define ARRAYLIST_CREATE_WITH_CAPACITY_AND_ALLOCATOR(name, capacity, allocator) \
+    arraylist_create_with_capacity_and_allocator_##name(capacity, allocator)
+
+#define ARRAYLIST_CREATE_WITH_ALLOCATOR(name, allocator) \
+    arraylist_create_with_allocator_##name(allocator)
+
+#define ARRAYLIST_INIT(name, arraylist) \
+    arraylist_init_##name(arraylist)
+
+#define ARRAYLIST_INIT_WITH_ALLOCATOR(name, arraylist, allocator) \
+    arraylist_init_with_allocator_##name(arraylist, allocator)
+
+#define ARRAYLIST_SMALL_INIT(name, small) \
+    arraylist_small_init_##name(small)
+
+#define ARRAYLIST_DEINIT(name, arraylist) \
+    arraylist_deinit_##name(arraylist)
+
 #define ARRAYLIST_DESTROY(name, arraylist) \
     arraylist_destroy_##name(arraylist)
 
 #define ARRAYLIST_COUNT(name, arraylist) \
     arraylist_count_##name(arraylist)
 
+#define ARRAYLIST_CAPACITY(name, arraylist) \
+    arraylist_capacity_##name(arraylist)
+
 #define ARRAYLIST_IS_EMPTY(name, arraylist) \
     arraylist_is_empty_##name(arraylist)
 
@@ -311,12 +5495,39 @@
 #define ARRAYLIST_GET_LAST(name, arraylist, out) \
     arraylist_get_last_##name(arraylist, out)
 
+#define ARRAYLIST_AT_UNCHECKED(name, arraylist, index) \
+    arraylist_at_unchecked_##name(arraylist, index)
+
+#define ARRAYLIST_DATA(name, arraylist) \
+    arraylist_data_##name(arraylist)
+
+#define ARRAYLIST_END(name, arraylist) \
+    arraylist_end_##name(arraylist)
+
 #define ARRAYLIST_SET(name, arraylist, index, new_element, out) \
     arraylist_set_##name(arraylist, index, new_element, out)
 
+#define ARRAYLIST_RESERVE(name, arraylist, capacity) \
+    arraylist_reserve_##name(arraylist, capacity)
+
+#define ARRAYLIST_SHRINK_TO_FIT(name, arraylist) \
+    arraylist_shrink_to_fit_##name(arraylist)
+
+#define ARRAYLIST_CLEAR(name, arraylist) \
+    arraylist_clear_##name(arraylist)
+
+#define ARRAYLIST_SET_GROWTH_POLICY(name, arraylist, policy) \
+    arraylist_set_growth_policy_##name(arraylist, policy)
+
 #define ARRAYLIST_ADD(name, arraylist, index, element) \
     arraylist_add_##name(arraylist, index, element)
 
+#define ARRAYLIST_ADD_RANGE(name, arraylist, index, src, n) \
+    arraylist_add_range_##name(arraylist, index, src, n)
+
+#define ARRAYLIST_EXTEND(name, dst, src) \
+    arraylist_extend_##name(dst, src)
+
 #define ARRAYLIST_ADD_FIRST(name, arraylist, element) \
     arraylist_add_first_##name(arraylist, element)
 
@@ -332,4 +5543,166 @@
 #define ARRAYLIST_REMOVE_LAST(name, arraylist, out) \
     arraylist_remove_last_##name(arraylist, out)
 
+#define ARRAYLIST_INDEX_OF(name, arraylist, value) \
+    arraylist_index_of_##name(arraylist, value)
+
+#define ARRAYLIST_CONTAINS(name, arraylist, value) \
+    arraylist_contains_##name(arraylist, value)
+
+#define ARRAYLIST_COUNT_EQ(name, arraylist, value) \
+    arraylist_count_eq_##name(arraylist, value)
+
+#define ARRAYLIST_MINMAX(name, arraylist, min, max) \
+    arraylist_minmax_##name(arraylist, min, max)
+
+#define ARRAYLIST_RADIX_SORT(name, arraylist) \
+    arraylist_radix_sort_##name(arraylist)
+
+#define ARRAYLIST_SORT(name, arraylist) \
+    arraylist_sort_##name(arraylist)
+
+#define ARRAYLIST_LOWER_BOUND(name, arraylist, value) \
+    arraylist_lower_bound_##name(arraylist, value)
+
+#define ARRAYLIST_UPPER_BOUND(name, arraylist, value) \
+    arraylist_upper_bound_##name(arraylist, value)
+
+#define ARRAYLIST_BINARY_SEARCH(name, arraylist, value) \
+    arraylist_binary_search_##name(arraylist, value)
+
+#define ARRAYLIST_PARALLEL_FOR(name, arraylist, fn, ctx, nthreads) \
+    arraylist_parallel_for_##name(arraylist, fn, ctx, nthreads)
+
+#define ARRAYLIST_PARALLEL_FOR_WITH_EXECUTOR(name, arraylist, fn, ctx, executor) \
+    arraylist_parallel_for_with_executor_##name(arraylist, fn, ctx, executor)
+
+#define ARRAYLIST_PARALLEL_REDUCE(name, arraylist, reduce, combine, ctx, nthreads, out) \
+    arraylist_parallel_reduce_##name(arraylist, reduce, combine, ctx, nthreads, out)
+
+#define ARRAYLIST_PARALLEL_REDUCE_WITH_EXECUTOR(name, arraylist, reduce, combine, ctx, executor, out) \
+    arraylist_parallel_reduce_with_executor_##name(arraylist, reduce, combine, ctx, executor, out)
+
+#define ARRAYLIST_PARALLEL_SORT(name, arraylist, nthreads) \
+    arraylist_parallel_sort_##name(arraylist, nthreads)
+
+#define ARRAYLIST_PARALLEL_SORT_WITH_EXECUTOR(name, arraylist, executor) \
+    arraylist_parallel_sort_with_executor_##name(arraylist, executor)
+
+#define ARRAYLIST_COLUMN(name, arraylist, field) \
+    arraylist_column_##name##_##field(arraylist)
+
+#define ARRAYLIST_SAVE(name, arraylist, path) \
+    arraylist_save_##name(arraylist, path)
+
+#define ARRAYLIST_MAP(name, path, mode) \
+    arraylist_map_##name(path, mode)
+
+#define ARRAYLIST_MAP_WITH_ALLOCATOR(name, path, mode, allocator) \
+    arraylist_map_with_allocator_##name(path, mode, allocator)
+
+#define ARRAYLIST_RESERVE_VIRTUAL(name, arraylist, max_capacity) \
+    arraylist_reserve_virtual_##name(arraylist, max_capacity)
+
+#define ARRAYLIST_STATS_OF(name, arraylist) \
+    arraylist_stats_##name(arraylist)
+
+#define ARRAYLIST_STATS_TOTALS(name) \
+    arraylist_stats_totals_##name()
+
+#define ARRAYLIST_TRACE_TOTALS(name, op, out) \
+    arraylist_trace_totals_##name(op, out)
+
+#define ARRAYLIST_RELEASE(name, arraylist, data, count, capacity) \
+    arraylist_release_##name(arraylist, data, count, capacity)
+
+#define ARRAYLIST_ADOPT(name, arraylist, data, count, capacity) \
+    arraylist_adopt_##name(arraylist, data, count, capacity)
+
+#define ARRAYLIST_SWAP(name, a, b) \
+    arraylist_swap_##name(a, b)
+
+#define ARRAYLIST_SNAPSHOT(name, arraylist, out) \
+    arraylist_snapshot_##name(arraylist, out)
+
+#define ARRAYLIST_SNAPSHOT_RETAIN(name, snapshot) \
+    arraylist_snapshot_retain_##name(snapshot)
+
+#define ARRAYLIST_SNAPSHOT_RELEASE(name, snapshot) \
+    arraylist_snapshot_release_##name(snapshot)
+
+#define ARRAYLIST_UNSHARE(name, arraylist) \
+    arraylist_unshare_##name(arraylist)
+
+#define ARRAYLIST_ADDRESS_OF(name, arraylist, index) \
+    arraylist_address_of_##name(arraylist, index)
+
+#define ARRAYLIST_SEGMENT_COUNT(name, arraylist) \
+    arraylist_segment_count_##name(arraylist)
+
+#define ARRAYLIST_SEGMENT(name, arraylist, segment, n) \
+    arraylist_segment_##name(arraylist, segment, n)
+
+#define ARRAYLIST_ITER(name, arraylist) \
+    arraylist_iter_##name(arraylist)
+
+#define ARRAYLIST_NEXT_BATCH(name, iter, ptr, max) \
+    arraylist_next_batch_##name(iter, ptr, max)
+
+#define ARRAYLIST_WRITE_FD(name, arraylist, fd) \
+    arraylist_write_fd_##name(arraylist, fd)
+
+#define ARRAYLIST_READ_FD(name, arraylist, fd) \
+    arraylist_read_fd_##name(arraylist, fd)
+
+#define ARRAYLIST_WRITE_VARINT_FD(name, arraylist, fd) \
+    arraylist_write_varint_fd_##name(arraylist, fd)
+
+#define ARRAYLIST_READ_VARINT_FD(name, arraylist, fd) \
+    arraylist_read_varint_fd_##name(arraylist, fd)
+
+#define ARRAYLIST_BLOCK_COUNT(name, arraylist) \
+    arraylist_block_count_##name(arraylist)
+
+#define ARRAYLIST_DECODE_BLOCK(name, arraylist, block, out) \
+    arraylist_decode_block_##name(arraylist, block, out)
+
+#define ARRAYLIST_PACKED_BYTES(name, arraylist) \
+    arraylist_packed_bytes_##name(arraylist)
+
+#define ARRAYLIST_HEAPIFY(name, arraylist) \
+    arraylist_heapify_##name(arraylist)
+
+#define ARRAYLIST_HEAP_PUSH(name, arraylist, element) \
+    arraylist_heap_push_##name(arraylist, element)
+
+#define ARRAYLIST_HEAP_PUSH_BATCH(name, arraylist, src, n) \
+    arraylist_heap_push_batch_##name(arraylist, src, n)
+
+#define ARRAYLIST_HEAP_POP(name, arraylist, out) \
+    arraylist_heap_pop_##name(arraylist, out)
+
+#define ARRAYLIST_INSERT(name, arraylist, element) \
+    arraylist_insert_##name(arraylist, element)
+
+#define ARRAYLIST_INSERT_RANGE(name, arraylist, src, n) \
+    arraylist_insert_range_##name(arraylist, src, n)
+
+#define ARRAYLIST_FLUSH(name, arraylist) \
+    arraylist_flush_##name(arraylist)
+
+#define ARRAYLIST_FIND(name, arraylist, key) \
+    arraylist_find_##name(arraylist, key)
+
+#define ARRAYLIST_ERASE(name, arraylist, key, out) \
+    arraylist_erase_##name(arraylist, key, out)
+
+#define ARRAYLIST_MERGE_FROM(name, arraylist, src) \
+    arraylist_merge_from_##name(arraylist, src)
+
+#define ARRAYLIST_SWAP_REMOVE(name, arraylist, index, out) \
+    arraylist_swap_remove_##name(arraylist, index, out)
+
+#define ARRAYLIST_REMOVE_IF(name, arraylist, pred, ctx) \
+    arraylist_remove_if_##name(arraylist, pred, ctx)
+
 #endif // ARRAYLIST_H
@@ -0,0 +1,600 @@
+#ifndef ARRAYLIST_HPP
+#define ARRAYLIST_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+/*
+ * C++ counterparts of the lists in `arraylist.h`, for C++17 and later.
+ * They follow the standard containers' names and conventions, so they work with `<algorithm>`
+ * and range-for. Running out of room throws `std::bad_alloc`, except in the `try_` methods of
+ * `FixedArrayList`, which return `nullptr` when it is full. The `unchecked_` methods only check their
+ * preconditions when `ARRAYLIST_DEBUG` is defined.
+ */
+#ifdef ARRAYLIST_DEBUG
+#define ARRAYLIST_HPP_ASSERT(cond) assert(cond)
+#else
+#define ARRAYLIST_HPP_ASSERT(cond) ((void)0)
+#endif
+
+#if __cplusplus >= 202002L
+#define ARRAYLIST_HPP_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#else
+#define ARRAYLIST_HPP_NO_UNIQUE_ADDRESS
+#endif
+
+namespace noodle {
+
+/*
+ * A list of at most `N` elements stored inside the object, like `GENERATE_FIXED_ARRAYLIST`.
+ * It never allocates, and `capacity()` is a constant expression, so there is no growth path.
+ * `T` must be trivially copyable and trivially default constructible. Elements are then moved
+ * with `memmove`, and destroying the list costs nothing.
+ */
+template <class T, std::size_t N>
+class FixedArrayList {
+    static_assert(std::is_trivially_copyable<T>::value, "FixedArrayList needs a trivially copyable type");
+    static_assert(std::is_trivially_default_constructible<T>::value,
+                  "FixedArrayList needs a trivially default constructible type");
+    static_assert(N > 0, "FixedArrayList needs room for at least one element");
+
+public:
+    using value_type             = T;
+    using size_type              = std::size_t;
+    using difference_type        = std::ptrdiff_t;
+    using reference              = T &;
+    using const_reference        = const T &;
+    using pointer                = T *;
+    using const_pointer          = const T *;
+    using iterator               = T *;
+    using const_iterator         = const T *;
+    using reverse_iterator       = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    /*
+     * Leaves the storage uninitialized, so constructing a list costs nothing whatever `N` is.
+     * That is also why this constructor is not `constexpr`.
+     */
+    FixedArrayList() noexcept : count_(0) {}
+
+    FixedArrayList(std::initializer_list<T> init) : count_(0) {
+        if (init.size() > N) {
+            throw std::bad_alloc();
+        }
+        std::memcpy(data_, init.begin(), init.size() * sizeof(T));
+        count_ = init.size();
+    }
+
+    static constexpr size_type capacity() noexcept { return N; }
+    static constexpr size_type max_size() noexcept { return N; }
+
+    size_type size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+    bool full() const noexcept { return count_ == N; }
+
+    T *data() noexcept { return data_; }
+    const T *data() const noexcept { return data_; }
+
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + count_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + count_; }
+    const_iterator cbegin() const noexcept { return data_; }
+    const_iterator cend() const noexcept { return data_ + count_; }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    T &operator[](size_type index) noexcept {
+        ARRAYLIST_HPP_ASSERT(index < count_);
+        return data_[index];
+    }
+
+    const T &operator[](size_type index) const noexcept {
+        ARRAYLIST_HPP_ASSERT(index < count_);
+        return data_[index];
+    }
+
+    T &at(size_type index) {
+        if (index >= count_) {
+            throw std::out_of_range("FixedArrayList::at");
+        }
+        return data_[index];
+    }
+
+    const T &at(size_type index) const {
+        if (index >= count_) {
+            throw std::out_of_range("FixedArrayList::at");
+        }
+        return data_[index];
+    }
+
+    T &front() noexcept { return (*this)[0]; }
+    const T &front() const noexcept { return (*this)[0]; }
+    T &back() noexcept { return (*this)[count_ - 1]; }
+    const T &back() const noexcept { return (*this)[count_ - 1]; }
+
+    template <class... Args>
+    T &unchecked_emplace_back(Args &&...args) {
+        ARRAYLIST_HPP_ASSERT(count_ < N);
+        T *slot = ::new (static_cast<void *>(&data_[count_])) T(std::forward<Args>(args)...);
+        count_ += 1;
+        return *slot;
+    }
+
+    template <class... Args>
+    T *try_emplace_back(Args &&...args) {
+        if (count_ == N) {
+            return nullptr;
+        }
+        return &unchecked_emplace_back(std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    T &emplace_back(Args &&...args) {
+        if (count_ == N) {
+            throw std::bad_alloc();
+        }
+        return unchecked_emplace_back(std::forward<Args>(args)...);
+    }
+
+    T &unchecked_push_back(const T &element) { return unchecked_emplace_back(element); }
+    T *try_push_back(const T &element) { return try_emplace_back(element); }
+    T &push_back(const T &element) { return emplace_back(element); }
+
+    void pop_back() noexcept {
+        ARRAYLIST_HPP_ASSERT(count_ > 0);
+        count_ -= 1;
+    }
+
+    iterator insert(const_iterator pos, const T &element) {
+        size_type index = static_cast<size_type>(pos - data_);
+        ARRAYLIST_HPP_ASSERT(index <= count_);
+        if (count_ == N) {
+            throw std::bad_alloc();
+        }
+        T copy = element;
+        std::memmove(&data_[index + 1], &data_[index], (count_ - index) * sizeof(T));
+        data_[index] = copy;
+        count_ += 1;
+        return &data_[index];
+    }
+
+    iterator erase(const_iterator first, const_iterator last) noexcept {
+        size_type index = static_cast<size_type>(first - data_);
+        size_type n     = static_cast<size_type>(last - first);
+        ARRAYLIST_HPP_ASSERT(index + n <= count_);
+        std::memmove(&data_[index], &data_[index + n], (count_ - index - n) * sizeof(T));
+        count_ -= n;
+        return &data_[index];
+    }
+
+    iterator erase(const_iterator pos) noexcept { return erase(pos, pos + 1); }
+
+    /*
+     * Replaces the element at `pos` with the last one, so the order is not preserved.
+     */
+    void swap_erase(const_iterator pos) noexcept {
+        size_type index = static_cast<size_type>(pos - data_);
+        ARRAYLIST_HPP_ASSERT(index < count_);
+        count_ -= 1;
+        data_[index] = data_[count_];
+    }
+
+    void resize(size_type n) {
+        if (n > N) {
+            throw std::bad_alloc();
+        }
+        for (size_type i = count_; i < n; i++) {
+            ::new (static_cast<void *>(&data_[i])) T();
+        }
+        count_ = n;
+    }
+
+    void clear() noexcept { count_ = 0; }
+
+#if __cplusplus >= 202002L
+    operator std::span<T>() noexcept { return std::span<T>(data_, count_); }
+    operator std::span<const T>() const noexcept { return std::span<const T>(data_, count_); }
+#endif
+
+private:
+    size_type count_;
+    T         data_[N];
+};
+
+/*
+ * A heap-allocated list, like `GENERATE_ARRAYLIST`. It keeps the same `data`/`count`/`capacity`
+ * triple and grows by 1.5x like `ARRAYLIST_GROWTH_1_5X`, but constructs and destroys its elements
+ * properly, so `T` may be any movable type. Storage comes from `Alloc`.
+ * It is move-only, so returning one from a function never copies it; `clone()` makes an explicit copy.
+ * Growing moves the elements if `T`'s move constructor is noexcept, and otherwise copies them,
+ * so a failed growth leaves the list unchanged.
+ */
+template <class T, class Alloc = std::allocator<T>>
+class ArrayList {
+    using traits = std::allocator_traits<Alloc>;
+
+public:
+    using value_type             = T;
+    using allocator_type         = Alloc;
+    using size_type              = std::size_t;
+    using difference_type        = std::ptrdiff_t;
+    using reference              = T &;
+    using const_reference        = const T &;
+    using pointer                = T *;
+    using const_pointer          = const T *;
+    using iterator               = T *;
+    using const_iterator         = const T *;
+    using reverse_iterator       = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    ArrayList() noexcept(noexcept(Alloc())) : ArrayList(Alloc()) {}
+
+    explicit ArrayList(const Alloc &alloc) noexcept : data_(nullptr), count_(0), capacity_(0), alloc_(alloc) {}
+
+    ArrayList(std::initializer_list<T> init, const Alloc &alloc = Alloc()) : ArrayList(alloc) {
+        reserve(init.size());
+        for (const T &element : init) {
+            unchecked_emplace_back(element);
+        }
+    }
+
+    ArrayList(const ArrayList &) = delete;
+    ArrayList &operator=(const ArrayList &) = delete;
+
+    ArrayList(ArrayList &&other) noexcept
+        : data_(other.data_), count_(other.count_), capacity_(other.capacity_), alloc_(std::move(other.alloc_)) {
+        other.data_     = nullptr;
+        other.count_    = 0;
+        other.capacity_ = 0;
+    }
+
+    ArrayList &operator=(ArrayList &&other) noexcept(traits::propagate_on_container_move_assignment::value ||
+                                                     traits::is_always_equal::value) {
+        if (this == &other) {
+            return *this;
+        }
+        if (traits::propagate_on_container_move_assignment::value || alloc_ == other.alloc_) {
+            release();
+            if constexpr (traits::propagate_on_container_move_assignment::value) {
+                alloc_ = std::move(other.alloc_);
+            }
+            data_           = other.data_;
+            count_          = other.count_;
+            capacity_       = other.capacity_;
+            other.data_     = nullptr;
+            other.count_    = 0;
+            other.capacity_ = 0;
+        } else {
+            /* The storage belongs to an allocator this list can't free through, so move element by element. */
+            clear();
+            reserve(other.count_);
+            for (T &element : other) {
+                unchecked_emplace_back(std::move(element));
+            }
+            other.clear();
+        }
+        return *this;
+    }
+
+    ~ArrayList() { release(); }
+
+    /*
+     * Returns a copy of the list, with room for exactly its elements.
+     */
+    ArrayList clone() const {
+        ArrayList copy(traits::select_on_container_copy_construction(alloc_));
+        copy.reserve(count_);
+        for (const T &element : *this) {
+            copy.unchecked_emplace_back(element);
+        }
+        return copy;
+    }
+
+    allocator_type get_allocator() const noexcept { return alloc_; }
+
+    size_type size() const noexcept { return count_; }
+    size_type capacity() const noexcept { return capacity_; }
+    size_type max_size() const noexcept { return traits::max_size(alloc_); }
+    bool empty() const noexcept { return count_ == 0; }
+
+    T *data() noexcept { return data_; }
+    const T *data() const noexcept { return data_; }
+
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + count_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + count_; }
+    const_iterator cbegin() const noexcept { return data_; }
+    const_iterator cend() const noexcept { return data_ + count_; }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    T &operator[](size_type index) noexcept {
+        ARRAYLIST_HPP_ASSERT(index < count_);
+        return data_[index];
+    }
+
+    const T &operator[](size_type index) const noexcept {
+        ARRAYLIST_HPP_ASSERT(index < count_);
+        return data_[index];
+    }
+
+    T &at(size_type index) {
+        if (index >= count_) {
+            throw std::out_of_range("ArrayList::at");
+        }
+        return data_[index];
+    }
+
+    const T &at(size_type index) const {
+        if (index >= count_) {
+            throw std::out_of_range("ArrayList::at");
+        }
+        return data_[index];
+    }
+
+    T &front() noexcept { return (*this)[0]; }
+    const T &front() const noexcept { return (*this)[0]; }
+    T &back() noexcept { return (*this)[count_ - 1]; }
+    const T &back() const noexcept { return (*this)[count_ - 1]; }
+
+    /*
+     * Grows the storage to hold at least `new_capacity` elements.
+     */
+    void reserve(size_type new_capacity) {
+        if (new_capacity > capacity_) {
+            reallocate(new_capacity);
+        }
+    }
+
+    /*
+     * Shrinks the storage to exactly `size()` elements, freeing it when the list is empty.
+     */
+    void shrink_to_fit() {
+        if (capacity_ == count_) {
+            return;
+        }
+        if (count_ == 0) {
+            release();
+            return;
+        }
+        reallocate(count_);
+    }
+
+    /*
+     * Constructs an element from `args` straight into the storage after the last one.
+     * `args` may refer to elements of the list.
+     */
+    template <class... Args>
+    T &emplace_back(Args &&...args) {
+        if (count_ < capacity_) {
+            return unchecked_emplace_back(std::forward<Args>(args)...);
+        }
+        size_type new_capacity = next_capacity(count_ + 1);
+        T *new_data = traits::allocate(alloc_, new_capacity);
+        try {
+            traits::construct(alloc_, new_data + count_, std::forward<Args>(args)...);
+        } catch (...) {
+            traits::deallocate(alloc_, new_data, new_capacity);
+            throw;
+        }
+        try {
+            relocate(data_, count_, new_data);
+        } catch (...) {
+            traits::destroy(alloc_, new_data + count_);
+            traits::deallocate(alloc_, new_data, new_capacity);
+            throw;
+        }
+        adopt(new_data, new_capacity);
+        count_ += 1;
+        return data_[count_ - 1];
+    }
+
+    /*
+     * Like `emplace_back`, for a list known to have room.
+     */
+    template <class... Args>
+    T &unchecked_emplace_back(Args &&...args) {
+        ARRAYLIST_HPP_ASSERT(count_ < capacity_);
+        traits::construct(alloc_, data_ + count_, std::forward<Args>(args)...);
+        count_ += 1;
+        return data_[count_ - 1];
+    }
+
+    T &push_back(const T &element) { return emplace_back(element); }
+    T &push_back(T &&element) { return emplace_back(std::move(element)); }
+
+    void pop_back() noexcept {
+        ARRAYLIST_HPP_ASSERT(count_ > 0);
+        count_ -= 1;
+        traits::destroy(alloc_, data_ + count_);
+    }
+
+    template <class... Args>
+    iterator emplace(const_iterator pos, Args &&...args) {
+        size_type index = static_cast<size_type>(pos - data_);
+        ARRAYLIST_HPP_ASSERT(index <= count_);
+        emplace_back(std::forward<Args>(args)...);
+        std::rotate(data_ + index, data_ + count_ - 1, data_ + count_);
+        return data_ + index;
+    }
+
+    iterator insert(const_iterator pos, const T &element) { return emplace(pos, element); }
+    iterator insert(const_iterator pos, T &&element) { return emplace(pos, std::move(element)); }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        T *begin = data_ + (first - data_);
+        T *end   = data_ + (last - data_);
+        ARRAYLIST_HPP_ASSERT(begin <= end && end <= data_ + count_);
+        T *kept = std::move(end, data_ + count_, begin);
+        destroy(kept, data_ + count_);
+        count_ = static_cast<size_type>(kept - data_);
+        return begin;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+    /*
+     * Replaces the element at `pos` with the last one, so the order is not preserved.
+     */
+    void swap_erase(const_iterator pos) {
+        size_type index = static_cast<size_type>(pos - data_);
+        ARRAYLIST_HPP_ASSERT(index < count_);
+        if (index != count_ - 1) {
+            data_[index] = std::move(data_[count_ - 1]);
+        }
+        pop_back();
+    }
+
+    void resize(size_type n) {
+        if (n < count_) {
+            erase(data_ + n, data_ + count_);
+            return;
+        }
+        reserve(n);
+        while (count_ < n) {
+            unchecked_emplace_back();
+        }
+    }
+
+    void resize(size_type n, const T &element) {
+        if (n < count_) {
+            erase(data_ + n, data_ + count_);
+            return;
+        }
+        if (n > capacity_) {
+            /* `element` may live in the storage about to be replaced. */
+            T copy = element;
+            reserve(n);
+            while (count_ < n) {
+                unchecked_emplace_back(copy);
+            }
+            return;
+        }
+        while (count_ < n) {
+            unchecked_emplace_back(element);
+        }
+    }
+
+    void clear() noexcept {
+        destroy(data_, data_ + count_);
+        count_ = 0;
+    }
+
+    void swap(ArrayList &other) noexcept {
+        using std::swap;
+        swap(data_, other.data_);
+        swap(count_, other.count_);
+        swap(capacity_, other.capacity_);
+        if constexpr (traits::propagate_on_container_swap::value) {
+            swap(alloc_, other.alloc_);
+        }
+    }
+
+    friend void swap(ArrayList &a, ArrayList &b) noexcept { a.swap(b); }
+
+#if __cplusplus >= 202002L
+    operator std::span<T>() noexcept { return std::span<T>(data_, count_); }
+    operator std::span<const T>() const noexcept { return std::span<const T>(data_, count_); }
+#endif
+
+private:
+    size_type next_capacity(size_type min_capacity) const {
+        if (min_capacity > max_size()) {
+            throw std::length_error("ArrayList");
+        }
+        size_type new_capacity = capacity_ + capacity_ / 2;
+        if (new_capacity < capacity_ || new_capacity > max_size()) {
+            new_capacity = max_size();
+        }
+        return new_capacity < min_capacity ? min_capacity : new_capacity;
+    }
+
+    /*
+     * Moves, or copies when moving could throw, `n` elements from `src` to uninitialized `dst`.
+     * If a copy throws, `src` is untouched and `dst` is left with nothing to destroy.
+     */
+    void relocate(T *src, size_type n, T *dst) {
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if (n > 0) {
+                std::memcpy(static_cast<void *>(dst), static_cast<const void *>(src), n * sizeof(T));
+            }
+            return;
+        }
+        size_type done = 0;
+        try {
+            for (; done < n; done++) {
+                traits::construct(alloc_, dst + done, std::move_if_noexcept(src[done]));
+            }
+        } catch (...) {
+            destroy(dst, dst + done);
+            throw;
+        }
+    }
+
+    void reallocate(size_type new_capacity) {
+        T *new_data = traits::allocate(alloc_, new_capacity);
+        try {
+            relocate(data_, count_, new_data);
+        } catch (...) {
+            traits::deallocate(alloc_, new_data, new_capacity);
+            throw;
+        }
+        adopt(new_data, new_capacity);
+    }
+
+    /*
+     * Replaces the storage with `new_data`, which already holds the elements.
+     */
+    void adopt(T *new_data, size_type new_capacity) noexcept {
+        size_type count = count_;
+        release();
+        data_     = new_data;
+        count_    = count;
+        capacity_ = new_capacity;
+    }
+
+    void destroy(T *first, T *last) noexcept {
+        if constexpr (!std::is_trivially_destructible<T>::value) {
+            for (; first != last; ++first) {
+                traits::destroy(alloc_, first);
+            }
+        }
+    }
+
+    void release() noexcept {
+        destroy(data_, data_ + count_);
+        if (data_ != nullptr) {
+            traits::deallocate(alloc_, data_, capacity_);
+        }
+        data_     = nullptr;
+        count_    = 0;
+        capacity_ = 0;
+    }
+
+    T        *data_;
+    size_type count_;
+    size_type capacity_;
+    ARRAYLIST_HPP_NO_UNIQUE_ADDRESS Alloc alloc_;
+};
+
+} // namespace noodle
+
+#endif // ARRAYLIST_HPP
@@ -0,0 +1,311 @@
+/*
+ * Micro-benchmarks for every generated ArrayList operation.
+ *
+ * Build and run from the repository root:
+ *
+ *     cc -O2 -std=c11 -I. bench/arraylist_bench.c -o arraylist_bench
+ *     ./arraylist_bench [max_count]
+ *
+ * Each operation is measured for element sizes of 1, 8, 64 and 256 bytes and for
+ * counts 10, 100, ... up to `max_count` (default 10^6, at most 10^8). Quadratic
+ * operations (add_first, middle insert and removal, remove_first) stop at
+ * `QUADRATIC_LIMIT`, and runs whose storage would exceed `MAX_BYTES` are skipped.
+ * create/destroy allocates a capacity of `count` elements.
+ *
+ * Output is one line per run: operation, element size, count, ns/op, bytes
+ * allocated in total and peak bytes live, counted through an ArrayListAllocator.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arraylist.h"
+
+#define QUADRATIC_LIMIT 100000
+#define MAX_BYTES       ((size_t)1 << 31)
+#define QUADRATIC_OPS   100000
+#define MIN_OPS         1000000
+#define BATCH_OPS       10000
+
+typedef struct { unsigned char bytes[1]; } Elem1;
+typedef struct { unsigned char bytes[8]; } Elem8;
+typedef struct { unsigned char bytes[64]; } Elem64;
+typedef struct { unsigned char bytes[256]; } Elem256;
+
+GENERATE_ARRAYLIST(E1, Elem1)
+GENERATE_ARRAYLIST(E8, Elem8)
+GENERATE_ARRAYLIST(E64, Elem64)
+GENERATE_ARRAYLIST(E256, Elem256)
+
+typedef struct {
+    size_t total;
+    size_t live;
+    size_t peak;
+} AllocStats;
+
+static void *counting_allocate(void *ctx, size_t size) {
+    AllocStats *stats = ctx;
+    stats->total += size;
+    stats->live += size;
+    if (stats->live > stats->peak) {
+        stats->peak = stats->live;
+    }
+    return malloc(size);
+}
+
+static void *counting_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    AllocStats *stats = ctx;
+    stats->total += new_size;
+    stats->live += new_size - old_size;
+    if (stats->live > stats->peak) {
+        stats->peak = stats->live;
+    }
+    return realloc(ptr, new_size);
+}
+
+static void counting_deallocate(void *ctx, void *ptr, size_t size) {
+    AllocStats *stats = ctx;
+    stats->live -= size;
+    free(ptr);
+}
+
+static AllocStats         alloc_stats;
+static ArrayListAllocator counting_allocator = {
+    counting_allocate, counting_reallocate, counting_deallocate, &alloc_stats,
+};
+
+static volatile unsigned char sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void report(const char *op, size_t element_size, size_t count, double ns, size_t ops) {
+    printf("%-14s %4zuB %10zu %10.2f ns/op %14zu B total %14zu B peak\n",
+           op, element_size, count, ns / (double)ops, alloc_stats.total, alloc_stats.peak);
+}
+
+static void reset_stats(void) {
+    memset(&alloc_stats, 0, sizeof(alloc_stats));
+}
+
+/*
+ * Generates `void bench_<name>(size_t count)`, which runs every benchmark for `ArrayList_<name>`.
+ * Each benchmark repeats until at least `MIN_OPS` operations were timed, or `QUADRATIC_OPS` for
+ * the quadratic ones. Removals drain lists that were filled outside the timer, `BATCH_OPS`
+ * elements at a time, so that reading the clock does not dominate small counts.
+ */
+#define GENERATE_BENCH(name, type)                                                             \
+    static ArrayList_##name *bench_filled_##name(size_t count) {                               \
+        ArrayList_##name *list = ARRAYLIST_CREATE_WITH_ALLOCATOR(name, &counting_allocator);   \
+        type element;                                                                          \
+        memset(&element, 1, sizeof(element));                                                  \
+        for (size_t i = 0; i < count; i++) {                                                   \
+            ARRAYLIST_ADD_LAST(name, list, element);                                           \
+        }                                                                                      \
+        return list;                                                                           \
+    }                                                                                          \
+                                                                                               \
+    static void bench_remove_first_##name(ArrayList_##name *list, size_t count) {              \
+        for (size_t i = 0; i < count; i++) {                                                   \
+            ARRAYLIST_REMOVE_FIRST(name, list, NULL);                                          \
+        }                                                                                      \
+    }                                                                                          \
+                                                                                               \
+    static void bench_remove_middle_##name(ArrayList_##name *list, size_t count) {             \
+        for (size_t i = 0; i < count; i++) {                                                   \
+            ARRAYLIST_REMOVE(name, list, ARRAYLIST_COUNT(name, list) / 2, NULL);               \
+        }                                                                                      \
+    }                                                                                          \
+                                                                                               \
+    static void bench_remove_last_##name(ArrayList_##name *list, size_t count) {               \
+        for (size_t i = 0; i < count; i++) {                                                   \
+            ARRAYLIST_REMOVE_LAST(name, list, NULL);                                           \
+        }                                                                                      \
+    }                                                                                          \
+                                                                                               \
+    static void bench_swap_remove_##name(ArrayList_##name *list, size_t count) {               \
+        for (size_t i = 0; i < count; i++) {                                                   \
+            ARRAYLIST_SWAP_REMOVE(name, list, 0, NULL);                                        \
+        }                                                                                      \
+    }                                                                                          \
+                                                                                               \
+    /* Times `drain` emptying freshly filled lists until at least `min_ops` were removed. */   \
+    static void bench_drain_##name(const char *op, size_t count, size_t min_ops,               \
+                                   void (*drain)(ArrayList_##name *, size_t)) {                \
+        size_t             batch = count >= BATCH_OPS ? 1 : BATCH_OPS / count;                 \
+        ArrayList_##name **lists = malloc(batch * sizeof(*lists));                             \
+        size_t             ops   = 0;                                                          \
+        double             ns    = 0;                                                          \
+        reset_stats();                                                                         \
+        while (ops < min_ops) {                                                                \
+            for (size_t b = 0; b < batch; b++) {                                               \
+                lists[b] = bench_filled_##name(count);                                         \
+            }                                                                                  \
+            double start = now_ns();                                                           \
+            for (size_t b = 0; b < batch; b++) {                                               \
+                drain(lists[b], count);                                                        \
+            }                                                                                  \
+            ns  += now_ns() - start;                                                           \
+            ops += batch * count;                                                              \
+            for (size_t b = 0; b < batch; b++) {                                               \
+                ARRAYLIST_DESTROY(name, lists[b]);                                             \
+            }                                                                                  \
+        }                                                                                      \
+        free(lists);                                                                           \
+        report(op, sizeof(type), count, ns, ops);                                              \
+    }                                                                                          \
+                                                                                               \
+    static void bench_##name(size_t count) {                                                   \
+        size_t reps = count >= MIN_OPS ? 1 : MIN_OPS / count;                                  \
+        size_t ops  = reps * count;                                                            \
+        type   element;                                                                        \
+        double start;                                                                          \
+        memset(&element, 1, sizeof(element));                                                  \
+                                                                                               \
+        reset_stats();                                                                         \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < MIN_OPS; r++) {                                                 \
+            ArrayList_##name *list = ARRAYLIST_CREATE_WITH_CAPACITY_AND_ALLOCATOR(             \
+                name, count, &counting_allocator);                                             \
+            ARRAYLIST_DESTROY(name, list);                                                     \
+        }                                                                                      \
+        report("create/destroy", sizeof(type), count, now_ns() - start, MIN_OPS);              \
+                                                                                               \
+        reset_stats();                                                                         \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < reps; r++) {                                                    \
+            ARRAYLIST_DESTROY(name, bench_filled_##name(count));                               \
+        }                                                                                      \
+        report("add_last", sizeof(type), count, now_ns() - start, ops);                        \
+                                                                                               \
+        reset_stats();                                                                         \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < reps; r++) {                                                    \
+            ArrayList_##name *list = ARRAYLIST_CREATE_WITH_ALLOCATOR(name,                     \
+                                                                     &counting_allocator);     \
+            ARRAYLIST_RESERVE(name, list, count);                                              \
+            for (size_t i = 0; i < count; i++) {                                               \
+                ARRAYLIST_ADD_LAST(name, list, element);                                       \
+            }                                                                                  \
+            ARRAYLIST_DESTROY(name, list);                                                     \
+        }                                                                                      \
+        report("add_last+rsv", sizeof(type), count, now_ns() - start, ops);                    \
+                                                                                               \
+        reset_stats();                                                                         \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < reps; r++) {                                                    \
+            ArrayList_##name *list = ARRAYLIST_CREATE_WITH_CAPACITY_AND_ALLOCATOR(             \
+                name, 0, &counting_allocator);                                                 \
+            for (size_t c = 1; c <= count; c++) {                                              \
+                if (c > ARRAYLIST_CAPACITY(name, list)) {                                      \
+                    ARRAYLIST_RESERVE(name, list, c + (c >> 1));                               \
+                }                                                                              \
+                ARRAYLIST_ADD_LAST(name, list, element);                                       \
+            }                                                                                  \
+            ARRAYLIST_DESTROY(name, list);                                                     \
+        }                                                                                      \
+        report("grow", sizeof(type), count, now_ns() - start, ops);                            \
+                                                                                               \
+        if (count <= QUADRATIC_LIMIT) {                                                        \
+            size_t qreps = count >= QUADRATIC_OPS ? 1 : QUADRATIC_OPS / count;                 \
+            size_t qops  = qreps * count;                                                      \
+                                                                                               \
+            reset_stats();                                                                     \
+            start = now_ns();                                                                  \
+            for (size_t r = 0; r < qreps; r++) {                                               \
+                ArrayList_##name *list = ARRAYLIST_CREATE_WITH_ALLOCATOR(name,                 \
+                                                                         &counting_allocator); \
+                for (size_t i = 0; i < count; i++) {                                           \
+                    ARRAYLIST_ADD_FIRST(name, list, element);                                  \
+                }                                                                              \
+                ARRAYLIST_DESTROY(name, list);                                                 \
+            }                                                                                  \
+            report("add_first", sizeof(type), count, now_ns() - start, qops);                  \
+                                                                                               \
+            reset_stats();                                                                     \
+            start = now_ns();                                                                  \
+            for (size_t r = 0; r < qreps; r++) {                                               \
+                ArrayList_##name *list = ARRAYLIST_CREATE_WITH_ALLOCATOR(name,                 \
+                                                                         &counting_allocator); \
+                for (size_t i = 0; i < count; i++) {                                           \
+                    ARRAYLIST_ADD(name, list, ARRAYLIST_COUNT(name, list) / 2, element);       \
+                }                                                                              \
+                ARRAYLIST_DESTROY(name, list);                                                 \
+            }                                                                                  \
+            report("add_middle", sizeof(type), count, now_ns() - start, qops);                 \
+                                                                                               \
+            bench_drain_##name("remove_first", count, QUADRATIC_OPS,                           \
+                               bench_remove_first_##name);                                     \
+            bench_drain_##name("remove_middle", count, QUADRATIC_OPS,                          \
+                               bench_remove_middle_##name);                                    \
+        }                                                                                      \
+                                                                                               \
+        bench_drain_##name("remove_last", count, MIN_OPS, bench_remove_last_##name);           \
+        bench_drain_##name("swap_remove", count, MIN_OPS, bench_swap_remove_##name);           \
+                                                                                               \
+        reset_stats();                                                                         \
+        ArrayList_##name *list = bench_filled_##name(count);                                   \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < reps; r++) {                                                    \
+            for (size_t i = 0; i < count; i++) {                                               \
+                type out = element;                                                            \
+                ARRAYLIST_GET(name, list, i, &out);                                            \
+                sink ^= out.bytes[0];                                                          \
+            }                                                                                  \
+        }                                                                                      \
+        report("get_scan", sizeof(type), count, now_ns() - start, ops);                        \
+                                                                                               \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < reps; r++) {                                                    \
+            for (size_t i = 0; i < count; i++) {                                               \
+                sink ^= ARRAYLIST_AT_UNCHECKED(name, list, i).bytes[0];                        \
+            }                                                                                  \
+        }                                                                                      \
+        report("unchecked_scan", sizeof(type), count, now_ns() - start, ops);                  \
+                                                                                               \
+        start = now_ns();                                                                      \
+        for (size_t r = 0; r < reps; r++) {                                                    \
+            for (size_t i = 0; i < count; i++) {                                               \
+                element.bytes[0] = (unsigned char)i;                                           \
+                ARRAYLIST_SET(name, list, i, element, NULL);                                   \
+            }                                                                                  \
+        }                                                                                      \
+        report("set_scan", sizeof(type), count, now_ns() - start, ops);                        \
+        ARRAYLIST_DESTROY(name, list);                                                         \
+    }
+
+GENERATE_BENCH(E1, Elem1)
+GENERATE_BENCH(E8, Elem8)
+GENERATE_BENCH(E64, Elem64)
+GENERATE_BENCH(E256, Elem256)
+
+int main(int argc, char **argv) {
+    size_t max_count = 1000000;
+    if (argc > 1) {
+        max_count = strtoull(argv[1], NULL, 10);
+        if (max_count > 100000000) {
+            max_count = 100000000;
+        }
+    }
+    for (size_t count = 10; count <= max_count; count *= 10) {
+        if (count * sizeof(Elem1) <= MAX_BYTES) {
+            bench_E1(count);
+        }
+        if (count * sizeof(Elem8) <= MAX_BYTES) {
+            bench_E8(count);
+        }
+        if (count * sizeof(Elem64) <= MAX_BYTES) {
+            bench_E64(count);
+        }
+        if (count * sizeof(Elem256) <= MAX_BYTES) {
+            bench_E256(count);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,364 @@
+/*
+ * Regression tests for arraylist.h. Build and run them from the repository root with CMake:
+ *
+ *     cmake -S . -B build && cmake --build build && ctest --test-dir build
+ *
+ * or by hand:
+ *
+ *     cc -O2 -std=gnu11 -I. tests/arraylist_test.c -o arraylist_test -pthread && ./arraylist_test
+ *
+ * The program prints every failed check and exits with a non-zero status if there was one.
+ */
+#define ARRAYLIST_STATS
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arraylist.h"
+
+#define LESS(a, b) ((a) < (b))
+
+GENERATE_ARRAYLIST(Int, int)
+GENERATE_ARRAYLIST_SORT(Int, int, LESS)
+GENERATE_ARRAYLIST_NUMERIC(Int, int)
+GENERATE_ARRAYLIST_PARALLEL(Int, int)
+GENERATE_ARRAYLIST_PARALLEL_SORT(Int, int, LESS)
+GENERATE_ARRAYLIST_DEQUE(Queue, int)
+GENERATE_PACKED_ARRAYLIST(Packed, int64_t)
+GENERATE_SOA_ARRAYLIST(Quote, (double, price), (int, venue))
+
+static int failures;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                              \
+        }                                                                            \
+    } while (0)
+
+/*
+ * An allocator that fails every request while `failing` is set.
+ */
+static int failing;
+
+static void *failing_allocate(void *ctx, size_t size) {
+    (void)ctx;
+    return failing ? NULL : malloc(size);
+}
+
+static void *failing_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return failing ? NULL : realloc(ptr, new_size);
+}
+
+static void failing_deallocate(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static ArrayListAllocator failing_allocator = {
+    failing_allocate, failing_reallocate, failing_deallocate, NULL,
+};
+
+static void negate(int *chunk, size_t n, void *ctx) {
+    (void)ctx;
+    for (size_t i = 0; i < n; i++) {
+        chunk[i] = -chunk[i];
+    }
+}
+
+static int sum(const int *chunk, size_t n, void *ctx) {
+    (void)ctx;
+    int total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += chunk[i];
+    }
+    return total;
+}
+
+static int add(int a, int b, void *ctx) {
+    (void)ctx;
+    return a + b;
+}
+
+static void fill_descending(ArrayList_Int *list, int n) {
+    ARRAYLIST_CLEAR(Int, list);
+    for (int i = n; i >= 1; i--) {
+        ARRAYLIST_ADD_LAST(Int, list, i);
+    }
+}
+
+static void test_snapshot_unshare(void) {
+    ArrayList_Int *list = ARRAYLIST_CREATE(Int);
+    for (int i = 0; i < 100; i++) {
+        ARRAYLIST_ADD_LAST(Int, list, i);
+    }
+
+    ArrayListSnapshot_Int snapshot;
+    CHECK(ARRAYLIST_SNAPSHOT(Int, list, &snapshot) == SUCCESS_Int);
+    CHECK(snapshot.count == 100 && snapshot.data == ARRAYLIST_DATA(Int, list));
+
+    /* Appending keeps sharing the buffer, and the snapshot still sees its own count. */
+    CHECK(ARRAYLIST_ADD_LAST(Int, list, 100) == SUCCESS_Int);
+    CHECK(snapshot.count == 100 && snapshot.data[99] == 99);
+
+    /* Any other change copies the buffer first. */
+    CHECK(ARRAYLIST_SET(Int, list, 0, -1, NULL) == SUCCESS_Int);
+    CHECK(snapshot.data[0] == 0);
+    CHECK(snapshot.data != ARRAYLIST_DATA(Int, list));
+    CHECK(ARRAYLIST_DATA(Int, list)[0] == -1 && ARRAYLIST_COUNT(Int, list) == 101);
+
+    ArrayListSnapshot_Int again;
+    CHECK(ARRAYLIST_SNAPSHOT(Int, list, &again) == SUCCESS_Int);
+    CHECK(ARRAYLIST_UNSHARE(Int, list) == SUCCESS_Int);
+    CHECK(again.data != ARRAYLIST_DATA(Int, list));
+    ARRAYLIST_DATA(Int, list)[1] = -2;
+    CHECK(again.data[1] == 1);
+
+    ArrayListSnapshot_Int retained = ARRAYLIST_SNAPSHOT_RETAIN(Int, &snapshot);
+    ARRAYLIST_SNAPSHOT_RELEASE(Int, &snapshot);
+    ARRAYLIST_DESTROY(Int, list);
+    CHECK(retained.count == 100 && retained.data[50] == 50);
+    CHECK(again.count == 101 && again.data[0] == -1);
+    ARRAYLIST_SNAPSHOT_RELEASE(Int, &retained);
+    ARRAYLIST_SNAPSHOT_RELEASE(Int, &again);
+}
+
+static void test_snapshot_sorts(void) {
+    ArrayList_Int *list = ARRAYLIST_CREATE(Int);
+    for (int op = 0; op < 4; op++) {
+        fill_descending(list, 100000);
+        ArrayListSnapshot_Int snapshot;
+        CHECK(ARRAYLIST_SNAPSHOT(Int, list, &snapshot) == SUCCESS_Int);
+        ArrayListError_Int res;
+        switch (op) {
+        case 0:
+            res = ARRAYLIST_SORT(Int, list);
+            break;
+        case 1:
+            res = ARRAYLIST_RADIX_SORT(Int, list);
+            break;
+        case 2:
+            res = ARRAYLIST_PARALLEL_SORT(Int, list, 4);
+            break;
+        default:
+            res = ARRAYLIST_PARALLEL_FOR(Int, list, negate, NULL, 4);
+            break;
+        }
+        CHECK(res == SUCCESS_Int);
+        CHECK(snapshot.data[0] == 100000 && snapshot.data[99999] == 1);
+        CHECK(ARRAYLIST_DATA(Int, list)[0] == (op == 3 ? -100000 : 1));
+        ARRAYLIST_SNAPSHOT_RELEASE(Int, &snapshot);
+    }
+    ARRAYLIST_DESTROY(Int, list);
+}
+
+static void test_snapshot_reserved(void) {
+    ArrayList_Int *list = ARRAYLIST_CREATE(Int);
+    CHECK(ARRAYLIST_RESERVE_VIRTUAL(Int, list, 1 << 20) == SUCCESS_Int);
+    for (int i = 0; i < 1000; i++) {
+        ARRAYLIST_ADD_LAST(Int, list, i);
+    }
+    int *data = ARRAYLIST_DATA(Int, list);
+
+    ArrayListSnapshot_Int snapshot;
+    CHECK(ARRAYLIST_SNAPSHOT(Int, list, &snapshot) == SUCCESS_Int);
+    for (int i = 0; i < 100000; i++) {
+        ARRAYLIST_ADD_LAST(Int, list, i);
+    }
+    ARRAYLIST_SET(Int, list, 0, 42, NULL);
+
+    /* Reserved storage never moves, so the snapshot holds its own copy. */
+    CHECK(ARRAYLIST_DATA(Int, list) == data && list->storage == ARRAYLIST_STORAGE_RESERVED);
+    CHECK(snapshot.data != data);
+    CHECK(snapshot.count == 1000 && snapshot.data[0] == 0 && snapshot.data[999] == 999);
+    ARRAYLIST_DESTROY(Int, list);
+    CHECK(snapshot.data[500] == 500);
+    ARRAYLIST_SNAPSHOT_RELEASE(Int, &snapshot);
+}
+
+static void test_deque_wraparound(void) {
+    ArrayList_Queue *queue = ARRAYLIST_CREATE_WITH_CAPACITY(Queue, 8);
+    CHECK(queue != NULL && ARRAYLIST_CAPACITY(Queue, queue) == 8);
+    int next = 0;
+    int expected = 0;
+    for (int i = 0; i < 6; i++) {
+        ARRAYLIST_ADD_LAST(Queue, queue, next++);
+    }
+    for (int i = 0; i < 4; i++) {
+        int out = -1;
+        CHECK(ARRAYLIST_REMOVE_FIRST(Queue, queue, &out) == SUCCESS_Queue && out == expected++);
+    }
+    /* The tail wraps around to the front of the buffer. */
+    for (int i = 0; i < 5; i++) {
+        ARRAYLIST_ADD_LAST(Queue, queue, next++);
+    }
+    CHECK(ARRAYLIST_CAPACITY(Queue, queue) == 8 && queue->head + ARRAYLIST_COUNT(Queue, queue) > 8);
+
+    /* Growing while wrapped keeps the logical order. */
+    for (int i = 0; i < 20; i++) {
+        ARRAYLIST_ADD_LAST(Queue, queue, next++);
+    }
+    CHECK(ARRAYLIST_COUNT(Queue, queue) == (size_t)(next - expected));
+    for (size_t i = 0; i < ARRAYLIST_COUNT(Queue, queue); i++) {
+        int out = -1;
+        CHECK(ARRAYLIST_GET(Queue, queue, i, &out) == SUCCESS_Queue && out == expected + (int)i);
+    }
+
+    /* Adding at the front from slot 0 wraps the head to the back. */
+    ARRAYLIST_CLEAR(Queue, queue);
+    for (int i = 0; i < 3; i++) {
+        ARRAYLIST_ADD_FIRST(Queue, queue, i);
+    }
+    for (int i = 0; i < 3; i++) {
+        CHECK(ARRAYLIST_AT_UNCHECKED(Queue, queue, i) == 2 - i);
+    }
+    ARRAYLIST_ADD(Queue, queue, 1, 10);
+    CHECK(ARRAYLIST_AT_UNCHECKED(Queue, queue, 0) == 2 && ARRAYLIST_AT_UNCHECKED(Queue, queue, 1) == 10);
+    int out = -1;
+    CHECK(ARRAYLIST_REMOVE(Queue, queue, 2, &out) == SUCCESS_Queue && out == 1);
+    CHECK(ARRAYLIST_COUNT(Queue, queue) == 3 && ARRAYLIST_AT_UNCHECKED(Queue, queue, 2) == 0);
+    ARRAYLIST_DESTROY(Queue, queue);
+}
+
+static void test_packed(void) {
+    ArrayList_Packed *list = ARRAYLIST_CREATE(Packed);
+    size_t count = 10 * ARRAYLIST_PACKED_BLOCK + 3;
+    int64_t *expected = malloc(count * sizeof(*expected));
+    uint64_t state = 88172645463325252ull;
+    for (size_t i = 0; i < count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (i % 97 == 0) {
+            expected[i] = i % 2 ? INT64_MIN : INT64_MAX;
+        } else {
+            expected[i] = 1000000 + (int64_t)(state & 0xFFFF) - 0x8000;
+        }
+        CHECK(ARRAYLIST_ADD_LAST(Packed, list, expected[i]) == SUCCESS_Packed);
+    }
+    CHECK(ARRAYLIST_COUNT(Packed, list) == count);
+
+    for (size_t i = 0; i < count; i++) {
+        int64_t out = 0;
+        CHECK(ARRAYLIST_GET(Packed, list, i, &out) == SUCCESS_Packed && out == expected[i]);
+    }
+    int64_t block[ARRAYLIST_PACKED_BLOCK];
+    size_t  decoded = 0;
+    for (size_t b = 0; b < ARRAYLIST_BLOCK_COUNT(Packed, list); b++) {
+        size_t n = ARRAYLIST_DECODE_BLOCK(Packed, list, b, block);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(block[i] == expected[decoded + i]);
+        }
+        decoded += n;
+    }
+    CHECK(decoded == count);
+
+    /* Removing across a block boundary and appending again re-encodes the last block. */
+    for (size_t i = count; i > count - ARRAYLIST_PACKED_BLOCK - 5; i--) {
+        int64_t out = 0;
+        CHECK(ARRAYLIST_REMOVE_LAST(Packed, list, &out) == SUCCESS_Packed && out == expected[i - 1]);
+    }
+    for (size_t i = count - ARRAYLIST_PACKED_BLOCK - 5; i < count; i++) {
+        ARRAYLIST_ADD_LAST(Packed, list, expected[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        CHECK(ARRAYLIST_AT_UNCHECKED(Packed, list, i) == expected[i]);
+    }
+    ARRAYLIST_DESTROY(Packed, list);
+    free(expected);
+}
+
+static void test_stats_after_failed_grow(void) {
+    ArrayList_Int list;
+    arraylist_init_with_allocator_Int(&list, &failing_allocator);
+    failing = 1;
+    CHECK(ARRAYLIST_ADD_LAST(Int, &list, 1) == MEMORY_ERROR_Int);
+    CHECK(ARRAYLIST_STATS_OF(Int, &list).grows == 0 && ARRAYLIST_STATS_OF(Int, &list).realloc_bytes == 0);
+    failing = 0;
+    CHECK(ARRAYLIST_ADD_LAST(Int, &list, 1) == SUCCESS_Int);
+    CHECK(ARRAYLIST_STATS_OF(Int, &list).grows == 1);
+    arraylist_deinit_Int(&list);
+
+    ArrayList_Queue queue;
+    arraylist_init_with_allocator_Queue(&queue, &failing_allocator);
+    failing = 1;
+    CHECK(ARRAYLIST_ADD_LAST(Queue, &queue, 1) == MEMORY_ERROR_Queue);
+    CHECK(ARRAYLIST_STATS_OF(Queue, &queue).grows == 0 && ARRAYLIST_STATS_OF(Queue, &queue).realloc_bytes == 0);
+    failing = 0;
+    CHECK(ARRAYLIST_ADD_LAST(Queue, &queue, 1) == SUCCESS_Queue);
+    CHECK(ARRAYLIST_STATS_OF(Queue, &queue).grows == 1);
+    arraylist_deinit_Queue(&queue);
+
+    ArrayList_Quote quotes;
+    arraylist_init_with_allocator_Quote(&quotes, &failing_allocator);
+    ArrayListRecord_Quote quote = { 1.5, 2 };
+    failing = 1;
+    CHECK(ARRAYLIST_ADD_LAST(Quote, &quotes, quote) == MEMORY_ERROR_Quote);
+    CHECK(ARRAYLIST_STATS_OF(Quote, &quotes).grows == 0);
+    failing = 0;
+    CHECK(ARRAYLIST_ADD_LAST(Quote, &quotes, quote) == SUCCESS_Quote);
+    CHECK(ARRAYLIST_STATS_OF(Quote, &quotes).grows == 1);
+    arraylist_deinit_Quote(&quotes);
+
+    /* Reserved storage fails to grow once the reservation is full. */
+    ArrayList_Int reserved;
+    arraylist_init_Int(&reserved);
+    CHECK(ARRAYLIST_RESERVE_VIRTUAL(Int, &reserved, 1024) == SUCCESS_Int);
+    while (ARRAYLIST_ADD_LAST(Int, &reserved, 1) == SUCCESS_Int) {
+    }
+    size_t grows = ARRAYLIST_STATS_OF(Int, &reserved).grows;
+    CHECK(ARRAYLIST_ADD_LAST(Int, &reserved, 1) == MEMORY_ERROR_Int);
+    CHECK(ARRAYLIST_STATS_OF(Int, &reserved).grows == grows);
+    arraylist_deinit_Int(&reserved);
+}
+
+static void test_parallel(void) {
+    ArrayList_Int list;
+    arraylist_init_with_allocator_Int(&list, &failing_allocator);
+    long expected = 0;
+    for (int i = 0; i < 50000; i++) {
+        ARRAYLIST_ADD_LAST(Int, &list, i % 7);
+        expected += i % 7;
+    }
+
+    int total = 0;
+    CHECK(ARRAYLIST_PARALLEL_REDUCE(Int, &list, sum, add, NULL, 4, &total) == SUCCESS_Int);
+    CHECK(total == expected);
+    CHECK(ARRAYLIST_PARALLEL_REDUCE_WITH_EXECUTOR(Int, &list, sum, add, NULL, NULL, &total) == SUCCESS_Int);
+    CHECK(total == expected);
+    failing = 1;
+    CHECK(ARRAYLIST_PARALLEL_REDUCE(Int, &list, sum, add, NULL, 4, &total) == MEMORY_ERROR_Int);
+    CHECK(ARRAYLIST_PARALLEL_SORT(Int, &list, 4) == MEMORY_ERROR_Int);
+    failing = 0;
+
+    /* Repeated calls reuse the threads of the built-in pool. */
+    for (int round = 0; round < 8; round++) {
+        CHECK(ARRAYLIST_PARALLEL_FOR_WITH_EXECUTOR(Int, &list, negate, NULL, NULL) == SUCCESS_Int);
+        CHECK(ARRAYLIST_PARALLEL_SORT(Int, &list, 8) == SUCCESS_Int);
+        for (size_t i = 1; i < ARRAYLIST_COUNT(Int, &list); i++) {
+            CHECK(ARRAYLIST_DATA(Int, &list)[i - 1] <= ARRAYLIST_DATA(Int, &list)[i]);
+        }
+    }
+    arraylist_deinit_Int(&list);
+}
+
+int main(void) {
+    test_snapshot_unshare();
+    test_snapshot_sorts();
+    test_snapshot_reserved();
+    test_deque_wraparound();
+    test_packed();
+    test_stats_after_failed_grow();
+    test_parallel();
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    puts("all tests passed");
+    return EXIT_SUCCESS;
+}